@@ -1,33 +1,138 @@
+import binascii
 import serial
-import threading
-
-# Cette fonction sera exécutée lorsqu'il y a des données disponibles sur le port série
-def receive_data(ser):
-    while True:
-        if ser.in_waiting > 0:
-            received_data = ser.readline().decode().strip()
-            print("Données reçues:", received_data)
-
-# Configuration de la communication UART
-ser = serial.Serial(
-    port='/dev/ttyAMA0',  # Assurez-vous d'utiliser le bon port UART de votre Raspberry Pi
-    baudrate=115200,        # Vitesse de transmission en bauds
-    parity=serial.PARITY_NONE,
-    stopbits=serial.STOPBITS_ONE,
-    bytesize=serial.EIGHTBITS,
-    timeout=1             # Délai d'attente pour la lecture
-)
-
-# Création d'un thread pour recevoir les données en arrière-plan
-receive_thread = threading.Thread(target=receive_data, args=(ser,), daemon=True)
-receive_thread.start()
-
-try:
-    while True:
-        data_to_send = input("Entrez la commande à envoyer via UART: ")
-        if data_to_send:
-            ser.write(data_to_send.encode())  # Envoyer des données encodées en bytes
-
-except KeyboardInterrupt:
-    ser.close()  # Fermer la communication UART lorsqu'on interrompt le programme avec Ctrl+C
+import struct
 
+# Protocole binaire avec la STM32 (Core/Inc/protocol.h) :
+# trame = COBS(type, seq, payload, crc16) suivie de 0x00, champs en little-endian
+PING, GET_ENV, GET_IMU, GET_ORIENT, SET_MOTOR, SET_CONFIG, GET_CONFIG = range(1, 8)
+RESPONSE = 0x80
+NACK = 0xFF
+ERRORS = {1: "argument", 2: "type inconnu", 3: "occupé", 4: "erreur capteur", 5: "clé inconnue"}
+CONFIG_KEYS = {"imu_profile": 0, "bmp_profile": 1, "fusion_gain": 2, "idle_timeout": 3}
+
+def cobs_encode(data):
+    out = bytearray()
+    block = bytearray()
+    for byte in data:
+        if byte == 0:
+            out += bytes([len(block) + 1]) + block
+            block = bytearray()
+        else:
+            block.append(byte)
+            if len(block) == 254:
+                out += b"\xff" + block
+                block = bytearray()
+    out += bytes([len(block) + 1]) + block
+    return bytes(out)
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("trame COBS invalide")
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+# CRC-16/CCITT-FALSE, le même que checksumCrc16() côté STM32
+def crc16(data):
+    return binascii.crc_hqx(data, 0xFFFF)
+
+class Stm32:
+    def __init__(self, ser, retries=3):
+        self.ser = ser
+        self.retries = retries
+        self.seq = 0
+
+    def request(self, msg_type, payload=b""):
+        self.seq = (self.seq + 1) & 0xFF
+        packet = bytes([msg_type, self.seq]) + payload
+        frame = cobs_encode(packet + struct.pack("<H", crc16(packet))) + b"\x00"
+        for _ in range(self.retries):
+            self.ser.write(frame)
+            while True:
+                raw = self.ser.read_until(b"\x00")  # vide si le délai d'attente expire
+                if not raw.endswith(b"\x00"):
+                    break
+                try:
+                    packet = cobs_decode(raw[:-1])
+                except ValueError:
+                    continue
+                if len(packet) < 4 or crc16(packet[:-2]) != struct.unpack("<H", packet[-2:])[0]:
+                    continue
+                if packet[1] != self.seq or packet[0] not in (msg_type | RESPONSE, NACK):
+                    continue  # réponse en retard à une requête précédente, ou à un autre type
+                if packet[0] == NACK:
+                    if len(packet) != 6 or packet[2] != msg_type:
+                        continue
+                    raise RuntimeError("refusé : " + ERRORS.get(packet[3], str(packet[3])))
+                return packet[2:-2]
+        raise TimeoutError("pas de réponse")
+
+    def ping(self, data=b"ping"):
+        return self.request(PING, data)
+
+    def env(self, sensor=0):
+        temperature, pressure = struct.unpack("<iI", self.request(GET_ENV, bytes([sensor])))
+        return temperature / 100, pressure / 256
+
+    def imu(self):
+        values = struct.unpack("<10h", self.request(GET_IMU))
+        mag = None if values[6] == -32768 else [v / 10 for v in values[6:9]]
+        return [v / 1000 for v in values[0:3]], [v / 10 for v in values[3:6]], mag, values[9] / 100
+
+    def orient(self):
+        return [v / 100 for v in struct.unpack("<3h", self.request(GET_ORIENT))]
+
+    def motor(self, angle, sign=1):
+        self.request(SET_MOTOR, bytes([angle, sign]))
+
+    def config(self, key, value=None):
+        if value is None:
+            payload = self.request(GET_CONFIG, bytes([key]))
+        else:
+            payload = self.request(SET_CONFIG, struct.pack("<Bi", key, value))
+        return struct.unpack("<Bi", payload)[1]
+
+if __name__ == "__main__":
+    # Configuration de la communication UART
+    ser = serial.Serial(
+        port='/dev/ttyAMA0',  # Assurez-vous d'utiliser le bon port UART de votre Raspberry Pi
+        baudrate=115200,        # Vitesse de transmission en bauds
+        parity=serial.PARITY_NONE,
+        stopbits=serial.STOPBITS_ONE,
+        bytesize=serial.EIGHTBITS,
+        timeout=0.2           # Délai d'attente d'une réponse avant de renvoyer la requête
+    )
+    stm32 = Stm32(ser)
+
+    try:
+        while True:
+            args = input("Commande (ping, env [capteur], imu, orient, motor <angle> [signe], config <clé> [valeur]): ").split()
+            if not args:
+                continue
+            try:
+                if args[0] == "ping":
+                    print(stm32.ping())
+                elif args[0] == "env":
+                    print("T = %.2f C, P = %.2f Pa" % stm32.env(*map(int, args[1:])))
+                elif args[0] == "imu":
+                    accel, gyro, mag, temperature = stm32.imu()
+                    print("A =", accel, "g, G =", gyro, "dps, M =", mag, "uT, T =", temperature, "C")
+                elif args[0] == "orient":
+                    print("roulis %.2f, tangage %.2f, lacet %.2f deg" % tuple(stm32.orient()))
+                elif args[0] == "motor":
+                    stm32.motor(*map(int, args[1:]))
+                elif args[0] == "config":
+                    print(args[1], "=", stm32.config(CONFIG_KEYS[args[1]], *map(int, args[2:])))
+                else:
+                    print("commande inconnue")
+            except (RuntimeError, TimeoutError, ValueError, KeyError, IndexError, TypeError) as e:
+                print("Erreur :", e)
+
+    except KeyboardInterrupt:
+        ser.close()  # Fermer la communication UART lorsqu'on interrompt le programme avec Ctrl+C
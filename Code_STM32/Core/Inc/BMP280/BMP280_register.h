@@ -13,7 +13,9 @@
  *
  **/
 
-#define BMP280_ADRESS	(((uint16_t)0x0077) << 1)
+#define BMP280_ADDRESS_SDO_GND	(((uint16_t)0x0076) << 1)
+#define BMP280_ADDRESS_SDO_VDD	(((uint16_t)0x0077) << 1)
+#define BMP280_ADRESS			BMP280_ADDRESS_SDO_VDD
 
 // Registers
 #define BMP280_REG_CALIB00              ((uint8_t)0x88) // Calibration data calib00
@@ -38,6 +40,16 @@
 #define BMP280_STBY_MSK                 ((uint8_t)0xE0) // 't_sb' in 'config'
 #define BMP280_FILTER_MSK               ((uint8_t)0x1C) // 'filter' in 'config'
 
+// Register bit positions
+#define BMP280_OSRS_T_POS               5U
+#define BMP280_OSRS_P_POS               2U
+#define BMP280_STBY_POS                 5U
+#define BMP280_FILTER_POS               2U
+
+// Status bits
+#define BMP280_STATUS_MEASURING         ((uint8_t)0x08) // conversion running
+#define BMP280_STATUS_IM_UPDATE         ((uint8_t)0x01) // NVM data being copied
+
 // Value to call a complete power-on-reset routine
 #define BMP280_SOFT_RESET_KEY           ((uint8_t)0xB6)
 
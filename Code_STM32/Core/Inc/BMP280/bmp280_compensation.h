@@ -0,0 +1,73 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    bmp280_compensation.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   BMP280 temperature and pressure compensation (datasheet formulas)
+ *
+ * Plain C on the cached calibration words, no HAL dependency:
+ * bmp280_compensation.c also builds on the host for Tests/test_bmp280.c.
+ *
+ **/
+#ifndef INC_BMP280_COMPENSATION_H_
+#define INC_BMP280_COMPENSATION_H_
+
+#include <stdint.h>
+
+// Compensation paths, select one with BMP280_COMPENSATION (e.g. -DBMP280_COMPENSATION=BMP280_COMP_INT32)
+#define BMP280_COMP_INT32	0	// datasheet 32-bit fixed point, 1 Pa resolution
+#define BMP280_COMP_INT64	1	// datasheet 64-bit fixed point, 1/256 Pa resolution
+#define BMP280_COMP_FLOAT	2	// single precision, runs on the FPU
+
+#ifndef BMP280_COMPENSATION
+#define BMP280_COMPENSATION	BMP280_COMP_INT64
+#endif
+
+// Worked example of the datasheet, section 3.12
+#define BMP280_REF_ADC_T	519888
+#define BMP280_REF_ADC_P	415148
+
+// Exact widths: the datasheet code relies on 32-bit wrap-around, also on a 64-bit host
+typedef int32_t BMP280_S32_t;
+typedef uint32_t BMP280_U32_t;
+typedef int64_t BMP280_S64_t;
+
+typedef struct bmp280Calib_s {
+	uint16_t dig_T1;
+	int16_t  dig_T2;
+	int16_t  dig_T3;
+	uint16_t dig_P1;
+	int16_t  dig_P2;
+	int16_t  dig_P3;
+	int16_t  dig_P4;
+	int16_t  dig_P5;
+	int16_t  dig_P6;
+	int16_t  dig_P7;
+	int16_t  dig_P8;
+	int16_t  dig_P9;
+}bmp280Calib_t;
+
+typedef struct bmp280Measure_s {
+	BMP280_S32_t temperature;	// 0.01 degC
+	BMP280_U32_t pressure;		// Q24.8 Pa, whatever the compensation path
+}bmp280Measure_t;
+
+extern const bmp280Calib_t bmp280RefCalib;	// calibration of the datasheet example
+
+BMP280_S32_t bmp280CompensateTInt32(const bmp280Calib_t *calib, BMP280_S32_t adc_T, BMP280_S32_t *tFine);
+BMP280_U32_t bmp280CompensatePInt32(const bmp280Calib_t *calib, BMP280_S32_t adc_P, BMP280_S32_t tFine);
+BMP280_U32_t bmp280CompensatePInt64(const bmp280Calib_t *calib, BMP280_S32_t adc_P, BMP280_S32_t tFine);
+float bmp280CompensateTFloat(const bmp280Calib_t *calib, BMP280_S32_t adc_T, BMP280_S32_t *tFine);
+float bmp280CompensatePFloat(const bmp280Calib_t *calib, BMP280_S32_t adc_P, BMP280_S32_t tFine);
+void bmp280Compensate(const bmp280Calib_t *calib, BMP280_S32_t adc_T, BMP280_S32_t adc_P, bmp280Measure_t *meas);
+void bmp280CompensateBatch(const bmp280Calib_t *calib, const BMP280_S32_t *adcT, const BMP280_S32_t *adcP,
+                           BMP280_S32_t *temperature, BMP280_U32_t *pressure, uint32_t n);
+uint8_t bmp280SelfTest(void);
+
+#endif /* INC_BMP280_COMPENSATION_H_ */
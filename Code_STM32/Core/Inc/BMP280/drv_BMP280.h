@@ -13,20 +13,93 @@
  *
  **/
 
-typedef long signed int BMP280_S32_t;
-
-typedef struct bmp280Struct_s {
-	uint16_t calibration[12];
-	uint32_t temperature;
-	uint32_t pressure;
-}bmp280Struct_t;
-
-uint8_t bmp280GetId(uint8_t *id);
-uint8_t bmp280Config(void);
-uint8_t bmp280GetCalib(bmp280Struct_t *param);
-uint8_t bmp280GetTemperature(bmp280Struct_t *bmp);
-uint8_t bmp280GetPressure(bmp280Struct_t *bmp);
-BMP280_S32_t bmp280CompensateTInt32(bmp280Struct_t adc);
-BMP280_S32_t bmp280CompensatePInt32(bmp280Struct_t adc);
-float bmp280GetCompensateTemp(void);
-float bmp280GetCompensatePress(void);
\ No newline at end of file
+#ifndef INC_DRV_BMP280_H_
+#define INC_DRV_BMP280_H_
+
+#include "main.h"
+#include "i2c_queue.h"
+#include "BMP280/bmp280_compensation.h"
+
+#define BMP280_CALIB_SIZE	24	// calib00..calib23 hold dig_T1..dig_P9, calib24/25 are reserved
+
+#define BMP280_MAX_DEVICES		4	// two addresses per bus
+#define BMP280_ASYNC_TIMEOUT_MS	20	// queue wait included, a 6-byte burst takes ~1 ms at 100 kHz
+
+typedef enum bmp280Profile_e {
+	BMP280_PROFILE_ULTRA_LOW_POWER = 0,	// x1/x1, filter off, 4 s standby
+	BMP280_PROFILE_STANDARD,			// P x4 / T x1, filter 4, 125 ms standby
+	BMP280_PROFILE_HIGH_RESOLUTION,		// P x16 / T x2, filter 16, 0.5 ms standby
+	BMP280_PROFILE_MAX_RATE,			// x1/x1, filter off, 0.5 ms standby
+	BMP280_PROFILE_COUNT,
+}bmp280Profile_t;
+
+#define BMP280_DEFAULT_PROFILE	BMP280_PROFILE_HIGH_RESOLUTION
+
+typedef enum bmp280State_e {
+	BMP280_STATE_IDLE = 0,		// no acquisition in progress
+	BMP280_STATE_BUSY,			// burst read running under interrupt
+	BMP280_STATE_READY,			// raw data received, waiting for bmp280PollMeasure()
+	BMP280_STATE_ERROR,			// I2C error reported by the HAL
+	BMP280_STATE_TIMEOUT,		// transfer aborted after bmp->timeout ms
+}bmp280State_t;
+
+typedef struct bmp280Stats_s {
+	uint32_t samples;				// measurements completed
+	uint32_t errors;				// I2C errors
+	uint32_t timeouts;				// transfers aborted on timeout
+	uint32_t syncBlockedCycles;		// CPU cycles spent in the last bmp280GetMeasure()
+	uint32_t asyncBlockedCycles;	// CPU cycles spent in bmp280StartMeasure() + bmp280PollMeasure() for the last sample
+}bmp280Stats_t;
+
+typedef struct bmp280Bench_s {
+	uint32_t cyclesInt32;		// temperature + pressure, CPU cycles per sample
+	uint32_t cyclesInt64;
+	uint32_t cyclesFloat;
+	uint32_t cyclesBatch;		// per sample, bmp280CompensateBatch() (64-bit path)
+	uint32_t batchSamplesPerSec;
+}bmp280Bench_t;
+
+typedef struct bmp280_s {
+	I2C_HandleTypeDef *hi2c;	// bus the sensor is wired to
+	uint16_t address;			// BMP280_ADDRESS_SDO_GND or BMP280_ADDRESS_SDO_VDD
+	bmp280Calib_t calib;		// trimming parameters, read once by bmp280Init()
+	uint8_t calibValid;			// 1 once calib holds the sensor's NVM content
+	bmp280Profile_t profile;	// measurement profile applied by bmp280Config()
+	uint32_t conversionTimeUs;	// maximum conversion time of the profile
+	uint32_t samplePeriodUs;	// conversion time + standby time in normal mode
+	BMP280_S32_t temperature;	// last raw adc_T
+	BMP280_S32_t pressure;		// last raw adc_P
+
+	volatile bmp280State_t state;			// asynchronous acquisition state
+	uint8_t rxBuf[6];						// press_msb..temp_xlsb filled by the DMA transfer
+	i2cRequest_t request;					// queued at I2C_QUEUE_PRIO_LOW
+	uint32_t startTick;						// HAL tick when the transfer was started
+	uint32_t startCycles;					// CPU cycles spent starting the transfer
+	uint32_t timeout;						// queue wait + transfer timeout in ms
+	void (*callback)(struct bmp280_s *bmp);	// optional, called from the I2C interrupt on completion
+	bmp280Stats_t stats;
+}bmp280_t;
+
+extern bmp280_t hbmp280[BMP280_MAX_DEVICES];	// sensors found by bmp280Probe()
+extern uint8_t bmp280Count;
+
+uint8_t bmp280GetId(bmp280_t *bmp, uint8_t *id);
+uint8_t bmp280Config(bmp280_t *bmp);
+uint8_t bmp280SetProfile(bmp280_t *bmp, bmp280Profile_t profile);
+uint32_t bmp280GetConversionTimeUs(bmp280Profile_t profile);
+uint8_t bmp280ForcedMeasure(bmp280_t *bmp, bmp280Measure_t *meas);
+uint8_t bmp280Init(bmp280_t *bmp, I2C_HandleTypeDef *hi2c, uint16_t address);
+uint8_t bmp280Probe(I2C_HandleTypeDef *hi2c);
+uint8_t bmp280GetCalib(bmp280_t *bmp);
+uint8_t bmp280GetTemperature(bmp280_t *bmp);
+uint8_t bmp280GetPressure(bmp280_t *bmp);
+uint8_t bmp280GetRaw(bmp280_t *bmp);
+uint8_t bmp280GetMeasure(bmp280_t *bmp, bmp280Measure_t *meas);
+void bmp280Benchmark(bmp280Bench_t *bench);
+uint8_t bmp280StartMeasure(bmp280_t *bmp);
+bmp280State_t bmp280PollMeasure(bmp280_t *bmp, bmp280Measure_t *meas);
+void bmp280AbortMeasure(bmp280_t *bmp);
+float bmp280GetCompensateTemp(bmp280_t *bmp);
+float bmp280GetCompensatePress(bmp280_t *bmp);
+
+#endif /* INC_DRV_BMP280_H_ */
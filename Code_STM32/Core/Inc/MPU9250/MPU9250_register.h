@@ -162,4 +162,50 @@
 #define YA_OFFSET_H      0x7A
 #define YA_OFFSET_L      0x7B
 #define ZA_OFFSET_H      0x7D
-#define ZA_OFFSET_L      0x7E
\ No newline at end of file
+#define ZA_OFFSET_L      0x7E
+
+// 8-bit bus addresses (7-bit address shifted left) used by the driver
+#define MPU9250_ADDRESS_AD0_LOW	(((uint16_t)0x0068) << 1)
+#define MPU9250_ADDRESS_AD0_HIGH	(((uint16_t)0x0069) << 1)
+
+#define MPU9250_WHO_AM_I_ID		0x71
+#define MPU9255_WHO_AM_I_ID		0x73
+
+// Register fields
+#define MPU9250_H_RESET			0x80	// PWR_MGMT_1: device reset
+#define MPU9250_CLKSEL_PLL		0x01	// PWR_MGMT_1: PLL on the gyro when ready
+#define MPU9250_GYRO_FS_POS		3		// GYRO_CONFIG[4:3]
+#define MPU9250_ACCEL_FS_POS	3		// ACCEL_CONFIG[4:3]
+#define MPU9250_DLPF_MASK		0x07	// CONFIG[2:0] and ACCEL_CONFIG2[2:0]
+#define MPU9250_CONFIG_FIFO_MODE	0x40	// CONFIG: stop writing when the FIFO is full
+#define MPU9250_FIFO_EN_TEMP	0x80	// FIFO_EN
+#define MPU9250_FIFO_EN_GYRO	0x70	// FIFO_EN: GYRO_XOUT | GYRO_YOUT | GYRO_ZOUT
+#define MPU9250_FIFO_EN_ACCEL	0x08	// FIFO_EN
+#define MPU9250_FIFO_EN_SLV0	0x01	// FIFO_EN
+#define MPU9250_USER_FIFO_EN	0x40	// USER_CTRL
+#define MPU9250_USER_FIFO_RST	0x04	// USER_CTRL
+#define MPU9250_FIFO_COUNT_MASK	0x1FFF	// FIFO_COUNTH[4:0]:FIFO_COUNTL
+#define MPU9250_INT_RAW_RDY_EN	0x01	// INT_ENABLE
+#define MPU9250_INT_FIFO_OFLOW	0x10	// INT_ENABLE / INT_STATUS
+#define MPU9250_INT_BYPASS_EN	0x02	// INT_PIN_CFG: host sees the AK8963 directly
+#define MPU9250_USER_I2C_MST_EN	0x20	// USER_CTRL
+#define MPU9250_I2C_MST_CLK_400K	0x0D	// I2C_MST_CTRL[3:0]
+#define MPU9250_I2C_MST_WAIT_FOR_ES	0x40	// I2C_MST_CTRL: data ready waits for the slave data
+#define MPU9250_I2C_SLV_READ	0x80	// I2C_SLVx_ADDR
+#define MPU9250_I2C_SLV_EN		0x80	// I2C_SLVx_CTRL
+
+#define AK8963_ADDRESS_8BIT		(((uint16_t)AK8963_ADDRESS) << 1)
+#define AK8963_WHO_AM_I_ID		0x48
+#define AK8963_CNTL_POWER_DOWN	0x00
+#define AK8963_CNTL_FUSE_ROM	0x0F
+#define AK8963_CNTL_CONT2_16BIT	0x16	// continuous 100 Hz, 16-bit output
+#define AK8963_ST2_HOFL			0x08	// magnetic sensor overflow
+#define MPU9250_GYRO_FCHOICE_B_MASK	0x03	// GYRO_CONFIG[1:0], 00 = DLPF in use
+#define MPU9250_ACCEL_FCHOICE_B	0x08	// ACCEL_CONFIG2[3], 1 = accel DLPF bypassed (1.13 kHz, 4 kHz)
+#define MPU9250_DLPF_BYPASS		7		// DLPF_CFG 7: gyro 3600 Hz, 8 kHz, SMPLRT_DIV ignored
+#define MPU9250_PWR_CYCLE		0x20	// PWR_MGMT_1: accel duty-cycled at LP_ACCEL_ODR
+#define MPU9250_DIS_GYRO		0x07	// PWR_MGMT_2: DIS_XG | DIS_YG | DIS_ZG
+#define MPU9250_INT_WOM_EN		0x40	// INT_ENABLE: wake on motion
+#define MPU9250_ACCEL_INTEL_EN	0x80	// MOT_DETECT_CTRL: wake-on-motion logic on
+#define MPU9250_ACCEL_INTEL_MODE	0x40	// MOT_DETECT_CTRL: compare with the previous sample
+#define MPU9250_LP_ODR_MAX		11		// LP_ACCEL_ODR: 0.24 Hz * 2^n, 11 = 500 Hz
@@ -11,4 +11,186 @@
  * @Created	2023-10-11
  * @brief
  *
- **/
\ No newline at end of file
+ **/
+#ifndef INC_DRV_MPU9250_H_
+#define INC_DRV_MPU9250_H_
+
+#include "main.h"
+#include "i2c_queue.h"
+
+#define MPU9250_BURST_SIZE		14		// ACCEL_XOUT_H..GYRO_ZOUT_L
+#define MPU9250_MAG_SIZE		7		// AK8963 HXL..HZH + ST2, in EXT_SENS_DATA_00..06
+#define MPU9250_BURST_SIZE_MAG	(MPU9250_BURST_SIZE + MPU9250_MAG_SIZE)
+#define AK8963_SENSITIVITY		0.15f	// uT/LSB in 16-bit output
+#define AK8963_MODE_DELAY_MS	10
+#define MPU9250_RESET_DELAY_MS	100
+#define MPU9250_TEMP_SENSITIVITY	333.87f	// LSB/degC
+#define MPU9250_TEMP_OFFSET			21.0f	// degC at 0 LSB
+#define MPU9250_FIFO_SIZE			512
+#define MPU9250_FIFO_MAX_SAMPLES	(MPU9250_FIFO_SIZE / MPU9250_BURST_SIZE)
+#define MPU9250_ACCEL_1G_2G			16384	// LSB/g at +-2g
+#define MPU9250_ACCEL_OFFSET_MAX	16383	// XA_OFFSET is 15-bit signed
+#define MPU9250_OFFSETS_MAGIC		0x31554D49	// "IMU1", flash record layout of mpu9250Offsets_t
+#define MPU9250_CALIB_DEFAULT_SAMPLES	500
+#define MPU9250_WOM_MG_PER_LSB		4		// WOM_THR resolution
+#define MPU9250_WAKE_WRITES			7		// register writes back to full rate
+#define MPU9250_GYRO_STARTUP_US		35000	// gyro start-up after leaving sleep, gyroValid is 0 meanwhile
+
+// Output data rate and bandwidth, applied by mpu9250SetProfile()
+typedef enum mpu9250Profile_e {
+	MPU9250_PROFILE_200HZ = 0,			// gyro 41 Hz / accel 44.8 Hz DLPF, 200 Hz
+	MPU9250_PROFILE_200HZ_LOW_NOISE,	// gyro 10 Hz / accel 10.2 Hz DLPF, 200 Hz
+	MPU9250_PROFILE_500HZ,				// gyro 92 Hz / accel 99 Hz DLPF, 500 Hz
+	MPU9250_PROFILE_1KHZ,				// gyro 41 Hz / accel 44.8 Hz DLPF, 1 kHz
+	MPU9250_PROFILE_RAW_8KHZ,			// DLPF bypassed, gyro 3.6 kHz / accel 1.13 kHz, 8 kHz: FIFO bursts only
+	MPU9250_PROFILE_COUNT,
+}mpu9250Profile_t;
+
+typedef enum mpu9250AccelFs_e {
+	MPU9250_ACCEL_FS_2G = 0,
+	MPU9250_ACCEL_FS_4G,
+	MPU9250_ACCEL_FS_8G,
+	MPU9250_ACCEL_FS_16G,
+}mpu9250AccelFs_t;
+
+typedef enum mpu9250GyroFs_e {
+	MPU9250_GYRO_FS_250DPS = 0,
+	MPU9250_GYRO_FS_500DPS,
+	MPU9250_GYRO_FS_1000DPS,
+	MPU9250_GYRO_FS_2000DPS,
+}mpu9250GyroFs_t;
+
+// One burst, byte-swapped to host order, in register order
+typedef struct __attribute__((packed)) mpu9250Raw_s {
+	int16_t accel[3];
+	int16_t temperature;
+	int16_t gyro[3];
+	int16_t mag[3];			// AK8963 axes (little-endian on the wire), 0 without magnetometer
+	uint8_t magStatus;		// AK8963 ST2
+}mpu9250Raw_t;
+
+typedef struct mpu9250Sample_s {
+	float accel[3];			// g
+	float gyro[3];			// deg/s
+	float temperature;		// degC
+	float mag[3];			// uT, ASA applied, rotated to the accel/gyro axes
+	uint8_t magValid;		// 0 without magnetometer or on sensor overflow
+}mpu9250Sample_t;
+
+typedef struct mpu9250FifoSample_s {
+	uint32_t timestampUs;	// back-computed from the drain time and the sample period
+	mpu9250Raw_t raw;
+	uint8_t gyroValid;		// 0 during the gyro start-up that follows a wake-on-motion wake-up
+}mpu9250FifoSample_t;
+
+// Offset registers, in register units so they do not depend on the full scale
+typedef struct mpu9250Offsets_s {
+	int16_t gyro[3];		// XG_OFFSET..ZG_OFFSET, 4 LSB at +-250dps per unit, added to the output
+	int16_t accel[3];		// XA_OFFSET..ZA_OFFSET[15:1], 0.98 mg per unit, factory trim included
+}mpu9250Offsets_t;
+
+typedef struct mpu9250Stats_s {
+	uint32_t samples;
+	uint32_t errors;
+	uint32_t readCycles;	// last burst read, core cycles
+	uint32_t fifoDrains;	// FIFO bursts read
+	uint32_t fifoSamples;	// samples delivered from the FIFO
+	uint32_t fifoOverflows;	// FIFO found full, samples were lost
+	uint32_t fifoMaxLevel;	// highest FIFO_COUNT seen, bytes
+	uint32_t fifoDrainCycles;	// last drain, count read + burst, core cycles
+	uint32_t magOverflows;		// samples with ST2.HOFL set
+	uint32_t irqEdges;			// INT rising edges
+	uint32_t irqOverruns;		// edges while the previous read was still running
+	uint32_t irqReads;			// reads completed from the interrupt path
+	uint32_t irqLatencyCycles;	// edge to samples delivered, last read
+	uint32_t irqLatencyMaxCycles;
+	uint64_t irqLatencyTotalCycles;
+	uint32_t womWakeups;		// wake-on-motion edges that restored full rate
+	uint32_t wakeCycles;		// last wake-up, edge to data-ready restored
+	uint32_t gyroInvalid;		// samples delivered with gyroValid = 0 after a wake-up
+}mpu9250Stats_t;
+
+typedef enum mpu9250IrqStage_e {
+	MPU9250_IRQ_BURST,			// data-ready: 14-byte register burst
+	MPU9250_IRQ_COUNT,			// FIFO: FIFO_COUNT read
+	MPU9250_IRQ_FIFO,			// FIFO: FIFO_R_W burst
+	MPU9250_IRQ_RESET,			// FIFO: reset after an overflow
+}mpu9250IrqStage_t;
+
+typedef enum mpu9250WomState_e {
+	MPU9250_WOM_OFF = 0,		// full-rate sampling
+	MPU9250_WOM_ARMED,			// accel-only cycle mode, INT on motion
+	MPU9250_WOM_WAKING,			// wake-up writes queued from the INT edge
+}mpu9250WomState_t;
+
+typedef struct mpu9250_s {
+	I2C_HandleTypeDef *hi2c;		// bus the IMU is wired to
+	uint16_t address;				// MPU9250_ADDRESS_AD0_LOW or MPU9250_ADDRESS_AD0_HIGH
+	mpu9250AccelFs_t accelFs;
+	mpu9250GyroFs_t gyroFs;
+	mpu9250Profile_t profile;		// rate and bandwidth applied by mpu9250Init() / mpu9250SetProfile()
+	uint8_t dlpf;					// DLPF_CFG of the profile
+	uint8_t sampleRateDiv;			// SMPLRT_DIV of the profile, ODR = 1 kHz / (1 + div) with the DLPF on
+	float accelScale;				// g per LSB, precomputed from accelFs
+	float gyroScale;				// deg/s per LSB, precomputed from gyroFs
+	uint32_t samplePeriodUs;		// 1 / ODR
+	uint8_t userCtrl;				// USER_CTRL bits kept across FIFO resets (I2C_MST_EN)
+	uint8_t magEnabled;				// AK8963 read as SLV0, burst and FIFO frames grow to 21 bytes
+	uint8_t burstSize;				// MPU9250_BURST_SIZE or MPU9250_BURST_SIZE_MAG
+	uint8_t magAsa[3];				// AK8963 fuse ROM sensitivity adjustment
+	float magScale[3];				// uT per LSB, ASA included
+	mpu9250Raw_t raw;				// last burst
+	mpu9250Offsets_t offsets;		// last written by mpu9250SetOffsets()
+
+	uint8_t fifoEnabled;
+	uint8_t fifoFrameSize;			// bytes per sample in the FIFO
+	uint16_t fifoWatermark;			// samples, the drain is skipped below
+	uint8_t fifoBuf[MPU9250_FIFO_SIZE];
+	mpu9250FifoSample_t fifoSamples[MPU9250_FIFO_MAX_SAMPLES];
+	void (*onSamples)(struct mpu9250_s *mpu, const mpu9250FifoSample_t *samples, uint16_t n);	// optional, from mpu9250FifoDrain() or the interrupt path
+
+	uint8_t irqEnabled;				// reads started by the INT pin, no polling
+	volatile uint8_t irqBusy;		// read chain in flight
+	volatile uint16_t irqPending;	// data-ready edges since the last FIFO read
+	volatile mpu9250IrqStage_t irqStage;
+	uint32_t edgeCycles;			// cycle counter at the edge that started the read
+	uint32_t edgeUs;				// timingMicros() at that edge
+	uint8_t countBuf[2];			// FIFO_COUNTH/L
+	uint8_t ctrlBuf[2];				// USER_CTRL values of the reset sequence
+	i2cRequest_t request;			// read chain, I2C_QUEUE_PRIO_HIGH
+	i2cRequest_t ctrlRequest[2];	// FIFO reset writes
+
+	volatile mpu9250WomState_t womState;
+	uint32_t wakeEdgeCycles;		// cycle counter at the wake-on-motion edge
+	volatile uint8_t gyroSettling;	// samples before gyroValidUs are delivered with gyroValid = 0
+	uint32_t gyroValidUs;			// timingMicros() once the gyro has started up
+	uint8_t wakeBuf[MPU9250_WAKE_WRITES];
+	i2cRequest_t wakeRequest[MPU9250_WAKE_WRITES];
+	mpu9250Stats_t stats;
+}mpu9250_t;
+
+extern mpu9250_t hmpu9250;
+
+uint8_t mpu9250Init(mpu9250_t *mpu, I2C_HandleTypeDef *hi2c, uint16_t address);
+uint8_t mpu9250GetId(mpu9250_t *mpu, uint8_t *id);
+uint8_t mpu9250SetFullScale(mpu9250_t *mpu, mpu9250AccelFs_t accelFs, mpu9250GyroFs_t gyroFs);
+uint8_t mpu9250SetProfile(mpu9250_t *mpu, mpu9250Profile_t profile);
+uint8_t mpu9250MagInit(mpu9250_t *mpu);
+void mpu9250Unpack(const mpu9250_t *mpu, const uint8_t *buf, mpu9250Raw_t *raw);
+void mpu9250Convert(const mpu9250_t *mpu, const mpu9250Raw_t *raw, mpu9250Sample_t *sample);
+uint8_t mpu9250ReadRaw(mpu9250_t *mpu, mpu9250Raw_t *raw);
+uint8_t mpu9250Read(mpu9250_t *mpu, mpu9250Sample_t *sample);
+uint8_t mpu9250FifoEnable(mpu9250_t *mpu, uint16_t watermark);
+uint8_t mpu9250FifoDisable(mpu9250_t *mpu);
+uint8_t mpu9250FifoDrain(mpu9250_t *mpu, uint16_t *count);
+uint8_t mpu9250IrqEnable(mpu9250_t *mpu, uint8_t enable);
+void mpu9250IrqHandler(mpu9250_t *mpu);
+uint8_t mpu9250GetOffsets(mpu9250_t *mpu, mpu9250Offsets_t *offsets);
+uint8_t mpu9250SetOffsets(mpu9250_t *mpu, const mpu9250Offsets_t *offsets);
+uint8_t mpu9250Calibrate(mpu9250_t *mpu, uint16_t samples);
+uint8_t mpu9250LoadOffsets(mpu9250_t *mpu);
+uint8_t mpu9250SaveOffsets(mpu9250_t *mpu);
+uint8_t mpu9250WomEnable(mpu9250_t *mpu, uint16_t thresholdMg, uint8_t lpOdr);
+uint8_t mpu9250WomWake(mpu9250_t *mpu);
+
+#endif /* INC_DRV_MPU9250_H_ */
@@ -0,0 +1,23 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    checksum.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   CRC computed by the STM32 CRC unit, CRC-16 in software
+ *
+ **/
+#ifndef INC_CHECKSUM_H_
+#define INC_CHECKSUM_H_
+
+#include "main.h"
+
+uint32_t checksumCrc32(const void *data, uint32_t len);
+uint16_t checksumCrc16(const void *data, uint32_t len);
+
+#endif /* INC_CHECKSUM_H_ */
@@ -0,0 +1,33 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    flash_store.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   One CRC-protected record in a reserved internal flash sector
+ *
+ **/
+#ifndef INC_FLASH_STORE_H_
+#define INC_FLASH_STORE_H_
+
+#include "main.h"
+
+#define FLASH_STORE_SECTOR		FLASH_SECTOR_7	// removed from FLASH in STM32F446RETX_FLASH.ld
+#define FLASH_STORE_ADDRESS		0x08060000U
+#define FLASH_STORE_MAX_LEN		256				// payload bytes
+
+typedef struct flashStoreHeader_s {
+	uint32_t magic;			// identifies the payload layout, change it with the layout
+	uint32_t length;		// payload bytes
+	uint32_t crc;			// checksumCrc32() of the payload
+}flashStoreHeader_t;
+
+uint8_t flashStoreLoad(uint32_t magic, void *data, uint32_t len);
+uint8_t flashStoreSave(uint32_t magic, const void *data, uint32_t len);
+
+#endif /* INC_FLASH_STORE_H_ */
@@ -0,0 +1,64 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    fusion.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   Madgwick orientation filter (gyro + accel + optional mag)
+ *
+ * Plain C on floats, no HAL dependency: fusion.c also builds on the host to
+ * replay recorded IMU logs.
+ *
+ **/
+#ifndef INC_FUSION_H_
+#define INC_FUSION_H_
+
+#include <stdint.h>
+
+#define FUSION_DEFAULT_GAIN		0.1f	// Madgwick beta, rad/s of gyro error corrected
+#define FUSION_RAD_TO_DEG		57.29578f
+#define FUSION_DEG_TO_RAD		0.017453293f
+
+typedef struct fusionQuaternion_s {
+	float w;
+	float x;
+	float y;
+	float z;
+}fusionQuaternion_t;
+
+// ZYX (yaw, pitch, roll) angles of the sensor frame, degrees
+typedef struct fusionEuler_s {
+	float roll;
+	float pitch;
+	float yaw;
+}fusionEuler_t;
+
+typedef struct fusionStats_s {
+	uint32_t updates;			// 9-axis and 6-axis updates
+	uint32_t updatesNoMag;		// updates that fell back to gyro + accel
+	uint32_t updatesNoGyro;		// updates without gyro integration, accel/mag correction only
+	uint32_t updateCycles;		// last update, core cycles (filled on target)
+	uint32_t updateMaxCycles;
+	uint64_t updateTotalCycles;
+}fusionStats_t;
+
+typedef struct fusion_s {
+	fusionQuaternion_t q;		// sensor frame to earth frame
+	float gain;					// beta
+	uint32_t lastUs;			// timestamp of the last sample, 0 before the first one
+	fusionStats_t stats;
+}fusion_t;
+
+extern fusion_t hfusion;
+
+void fusionInit(fusion_t *fusion, float gain);
+void fusionSetGain(fusion_t *fusion, float gain);
+void fusionUpdate(fusion_t *fusion, const float gyro[3], const float accel[3], const float *mag, float dt);
+void fusionGetEuler(const fusionQuaternion_t *q, fusionEuler_t *euler);
+
+#endif /* INC_FUSION_H_ */
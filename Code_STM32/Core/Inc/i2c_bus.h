@@ -0,0 +1,61 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    i2c_bus.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   Bounded-time I2C register access with bus recovery, shared by the sensor drivers
+ *
+ **/
+#ifndef INC_I2C_BUS_H_
+#define INC_I2C_BUS_H_
+
+#include "main.h"
+
+#define I2C_BUS_COUNT				3	// I2C1..I2C3
+#define I2C_BUS_TIMEOUT_MS			10	// default per-transaction timeout
+#define I2C_BUS_RECOVERY_PULSES		9	// SCL clocks to release a slave holding SDA
+#define I2C_BUS_SPEED_STANDARD		100000
+#define I2C_BUS_SPEED_FAST			400000
+#define I2C_BUS_BENCH_MAX_LEN		32	// largest burst measured by i2cBusBenchmark()
+
+typedef struct i2cBusStats_s {
+	uint32_t transfers;			// transactions issued
+	uint32_t errors;			// transactions that failed, all causes
+	uint32_t timeouts;			// HAL_TIMEOUT
+	uint32_t nacks;				// address or data not acknowledged
+	uint32_t busy;				// bus found busy at start (stuck BUSY flag)
+	uint32_t recoveries;		// recovery sequences run
+	uint32_t recoveryFailures;	// SDA still low after the recovery sequence
+	uint32_t worstCycles;		// longest transaction including recovery, core cycles
+}i2cBusStats_t;
+
+typedef struct i2cBusBench_s {
+	uint32_t speed;				// SCL frequency during the run, Hz
+	uint32_t duty;				// I2C_DUTYCYCLE_2 or I2C_DUTYCYCLE_16_9
+	uint32_t transactions;		// successful transactions
+	uint32_t errors;			// failed transactions
+	uint32_t bytesPerSec;		// payload throughput
+	uint32_t latencyAvgUs;		// mean transaction time
+	uint32_t latencyMaxUs;		// worst transaction time
+}i2cBusBench_t;
+
+void i2cBusSetTimeout(uint32_t timeoutMs);
+uint32_t i2cBusGetTimeout(void);
+uint32_t i2cBusTransferTimeout(I2C_HandleTypeDef *hi2c, uint16_t len);
+uint8_t i2cBusRead(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, uint8_t *buf, uint16_t len);
+uint8_t i2cBusWrite(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, const uint8_t *buf, uint16_t len);
+uint8_t i2cBusIsReady(I2C_HandleTypeDef *hi2c, uint16_t devAddr);
+void i2cBusHandleError(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status);
+uint8_t i2cBusRecover(I2C_HandleTypeDef *hi2c);
+i2cBusStats_t* i2cBusGetStats(I2C_HandleTypeDef *hi2c);
+uint8_t i2cBusSetSpeed(I2C_HandleTypeDef *hi2c, uint32_t speed, uint32_t duty);
+uint8_t i2cBusBenchmark(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, uint16_t len,
+		uint32_t loops, i2cBusBench_t *bench);
+
+#endif /* INC_I2C_BUS_H_ */
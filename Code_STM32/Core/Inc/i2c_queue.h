@@ -0,0 +1,63 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    i2c_queue.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   Prioritized asynchronous I2C transactions, chained by DMA from the completion interrupt
+ *
+ **/
+#ifndef INC_I2C_QUEUE_H_
+#define INC_I2C_QUEUE_H_
+
+#include "main.h"
+
+#define I2C_QUEUE_DEPTH		8	// pending requests per priority
+#define I2C_QUEUE_IRQ_PRIORITY	1	// NVIC priority of I2C, I2C DMA and IMU EXTI (i2c.c, gpio.c), masked by the queue lock
+
+typedef enum{
+	I2C_QUEUE_PRIO_HIGH,		// IMU, overtakes everything queued below
+	I2C_QUEUE_PRIO_NORMAL,		// blocking driver calls (configuration, calibration)
+	I2C_QUEUE_PRIO_LOW,			// barometer
+	I2C_QUEUE_PRIO_COUNT,
+}i2cQueuePrio_t;
+
+typedef struct i2cRequest_s {
+	uint16_t devAddr;			// 8-bit device address (7-bit address shifted left)
+	uint8_t reg;				// first register
+	uint8_t write;				// 0 read, 1 write
+	uint8_t *buf;				// must stay valid until completion
+	uint16_t len;
+	void (*callback)(struct i2cRequest_s *req);	// from the completion interrupt or i2cQueueProcess()
+	void *context;				// owner of the request, free for the callback
+	volatile HAL_StatusTypeDef status;			// HAL_BUSY while queued or in flight
+	uint32_t submitCycles;		// timestamp of i2cQueueSubmit()
+}i2cRequest_t;
+
+typedef struct i2cQueueStats_s {
+	uint32_t submitted;
+	uint32_t completed;
+	uint32_t errors;			// failed, timed out or cancelled in flight
+	uint32_t rejected;			// queue full at submission
+	uint32_t depth;				// requests waiting now
+	uint32_t maxDepth;
+	uint64_t waitTotalCycles;	// submission to start of transfer
+	uint32_t waitMaxCycles;
+}i2cQueueStats_t;
+
+uint8_t i2cQueueInit(I2C_HandleTypeDef *hi2c);
+uint8_t i2cQueueEnabled(I2C_HandleTypeDef *hi2c);
+uint8_t i2cQueueSubmit(I2C_HandleTypeDef *hi2c, i2cRequest_t *req, i2cQueuePrio_t prio);
+uint8_t i2cQueueCancel(I2C_HandleTypeDef *hi2c, i2cRequest_t *req);
+uint8_t i2cQueueTransfer(I2C_HandleTypeDef *hi2c, i2cRequest_t *req, i2cQueuePrio_t prio);
+void i2cQueuePause(I2C_HandleTypeDef *hi2c);
+void i2cQueueResume(I2C_HandleTypeDef *hi2c);
+void i2cQueueProcess(void);
+const i2cQueueStats_t* i2cQueueGetStats(I2C_HandleTypeDef *hi2c, i2cQueuePrio_t prio);
+
+#endif /* INC_I2C_QUEUE_H_ */
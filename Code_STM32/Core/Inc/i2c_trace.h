@@ -0,0 +1,61 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    i2c_trace.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   RAM ring buffer of I2C transfers with per-device timing statistics
+ *
+ **/
+#ifndef INC_I2C_TRACE_H_
+#define INC_I2C_TRACE_H_
+
+#include "main.h"
+
+#define I2C_TRACE_DEPTH			128	// transfers kept, power of two
+#define I2C_TRACE_LINE_MAX		64	// longest I2C_TRACE output line, bytes
+#define I2C_TRACE_MAX_DEVICES	8	// devices reported by i2cTraceAnalyze()
+
+typedef struct i2cTraceEntry_s {
+	uint32_t timestampUs;		// start of the transfer, timingMicros()
+	uint32_t durationCycles;	// core cycles from start to completion
+	uint16_t devAddr;			// 8-bit device address
+	uint16_t len;				// payload bytes
+	uint8_t reg;				// first register
+	uint8_t write;				// 0 read, 1 write
+	uint8_t status;				// HAL_StatusTypeDef
+	uint8_t bus;				// 1 for I2C1 ... 3 for I2C3
+}i2cTraceEntry_t;
+
+typedef struct i2cTraceDevice_s {
+	uint16_t devAddr;
+	uint16_t count;				// transfers in the window
+	uint16_t errors;			// transfers not HAL_OK
+	uint32_t totalUs;			// bus time of this device in the window
+	uint32_t p50Us;
+	uint32_t p99Us;
+}i2cTraceDevice_t;
+
+typedef struct i2cTraceReport_s {
+	uint32_t entries;			// transfers in the window
+	uint32_t windowUs;			// first start to last completion
+	uint32_t utilizationPermille;	// bus busy time / windowUs
+	uint32_t deviceCount;
+	i2cTraceDevice_t devices[I2C_TRACE_MAX_DEVICES];
+}i2cTraceReport_t;
+
+extern volatile uint8_t i2cTraceEnabled;
+
+void i2cTraceRecord(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, uint16_t len, uint8_t write,
+		uint32_t startCycles, HAL_StatusTypeDef status);
+void i2cTraceClear(void);
+uint32_t i2cTraceCount(void);
+uint8_t i2cTraceGet(uint32_t age, i2cTraceEntry_t *entry);
+void i2cTraceAnalyze(i2cTraceReport_t *report);
+
+#endif /* INC_I2C_TRACE_H_ */
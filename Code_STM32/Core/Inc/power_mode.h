@@ -0,0 +1,46 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    power_mode.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   Active / idle sampling modes gated by the MPU9250 wake-on-motion
+ *
+ **/
+#ifndef INC_POWER_MODE_H_
+#define INC_POWER_MODE_H_
+
+#include "main.h"
+#include "MPU9250/drv_MPU9250.h"
+
+#define POWER_MODE_IDLE_TIMEOUT_MS		10000	// no motion for this long: idle, 0 = always active
+#define POWER_MODE_THRESHOLD_MG			60		// wake-on-motion and active motion threshold
+#define POWER_MODE_GYRO_THRESHOLD_DPS	5.0f	// active: rotation counted as motion
+#define POWER_MODE_LP_ODR				8		// LP_ACCEL_ODR 62.5 Hz: motion seen within 16 ms
+
+typedef enum powerModeState_e {
+	POWER_MODE_ACTIVE = 0,		// IMU at its profile rate, BMP280 at its own profile
+	POWER_MODE_IDLE,			// IMU in wake-on-motion, BMP280 in ultra low power (4 s)
+	POWER_MODE_COUNT,
+}powerModeState_t;
+
+typedef struct powerModeStats_s {
+	powerModeState_t mode;
+	uint32_t entries[POWER_MODE_COUNT];		// transitions into each mode
+	uint32_t timeMs[POWER_MODE_COUNT];		// time spent in each mode, current one included
+	uint32_t failures;						// transitions to idle refused by the IMU
+	uint32_t idleTimeoutMs;
+	uint16_t thresholdMg;
+}powerModeStats_t;
+
+void powerModeInit(mpu9250_t *mpu, uint32_t idleTimeoutMs, uint16_t thresholdMg);
+void powerModeSample(const mpu9250Sample_t *sample);
+void powerModeProcess(void);
+void powerModeGetStats(powerModeStats_t *stats);
+
+#endif /* INC_POWER_MODE_H_ */
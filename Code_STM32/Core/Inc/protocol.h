@@ -0,0 +1,75 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    protocol.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   Binary command/response protocol with the Raspberry Pi
+ *
+ * Frame on the wire: COBS(type, seq, payload, crc16) followed by a 0x00
+ * delimiter. The CRC-16/CCITT-FALSE covers type, seq and payload and is sent
+ * little-endian, as every multi-byte field. A response carries the request
+ * type with bit 7 set and the same seq; a refused request gets a
+ * PROTOCOL_NACK whose payload is the request type and a protocolError_t.
+ *
+ **/
+#ifndef INC_PROTOCOL_H_
+#define INC_PROTOCOL_H_
+
+#include "main.h"
+
+#define PROTOCOL_MAX_PAYLOAD	32		// bytes after type and seq
+#define PROTOCOL_HEADER_SIZE	2		// type, seq
+#define PROTOCOL_CRC_SIZE		2
+#define PROTOCOL_MAX_PACKET		(PROTOCOL_HEADER_SIZE + PROTOCOL_MAX_PAYLOAD + PROTOCOL_CRC_SIZE)
+#define PROTOCOL_MAX_FRAME		(PROTOCOL_MAX_PACKET + PROTOCOL_MAX_PACKET / 254 + 2)	// COBS overhead + delimiter
+#define PROTOCOL_RESPONSE		0x80	// set in the type of every response
+
+// Request types, payloads little-endian. Response payload after the arrow.
+typedef enum protocolType_e {
+	PROTOCOL_PING = 0x01,			// any bytes -> the same bytes
+	PROTOCOL_GET_ENV,				// [sensor] -> int32 temperature 0.01 degC, uint32 pressure Q24.8 Pa
+	PROTOCOL_GET_IMU,				// -> int16 accel[3] mg, gyro[3] 0.1 dps, mag[3] 0.1 uT (INT16_MIN if invalid), temperature 0.01 degC
+	PROTOCOL_GET_ORIENT,			// -> int16 roll, pitch, yaw, 0.01 deg
+	PROTOCOL_SET_MOTOR,				// uint8 angle, uint8 sign -> empty
+	PROTOCOL_SET_CONFIG,			// uint8 key, int32 value -> key, value as applied
+	PROTOCOL_GET_CONFIG,			// uint8 key -> key, int32 value
+	PROTOCOL_TYPE_COUNT,
+	PROTOCOL_NACK = 0xFF,			// uint8 request type, uint8 protocolError_t
+}protocolType_t;
+
+typedef enum protocolError_e {
+	PROTOCOL_ERROR_LENGTH = 1,		// payload size does not match the type, or value out of range
+	PROTOCOL_ERROR_TYPE,			// unknown request type
+	PROTOCOL_ERROR_BUSY,			// previous acquisition still running, retry
+	PROTOCOL_ERROR_DEVICE,			// sensor or bus error
+	PROTOCOL_ERROR_KEY,				// unknown configuration key
+}protocolError_t;
+
+typedef enum protocolConfig_e {
+	PROTOCOL_CONFIG_IMU_PROFILE = 0,	// mpu9250Profile_t
+	PROTOCOL_CONFIG_BMP_PROFILE,		// bmp280Profile_t of sensor 0
+	PROTOCOL_CONFIG_FUSION_GAIN,		// Madgwick gain x1000
+	PROTOCOL_CONFIG_IDLE_TIMEOUT,		// power mode idle timeout, ms, 0 = always active
+	PROTOCOL_CONFIG_COUNT,
+}protocolConfig_t;
+
+typedef struct protocolStats_s {
+	uint32_t rxFrames;				// valid requests
+	uint32_t crcErrors;				// frames dropped on a bad CRC or COBS encoding
+	uint32_t overflows;				// frames dropped, longer than PROTOCOL_MAX_FRAME
+	uint32_t nacks;					// requests refused
+	uint32_t txFrames;				// responses queued
+	uint32_t txDropped;				// responses refused by the transmit ring
+}protocolStats_t;
+
+uint8_t protocolInit(UART_HandleTypeDef *huart);
+void protocolProcess(void);
+const protocolStats_t* protocolGetStats(void);
+
+#endif /* INC_PROTOCOL_H_ */
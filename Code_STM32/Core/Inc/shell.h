@@ -13,13 +13,57 @@
  *
  **/
 
-#define UART_RX_BUFFER_SIZE 1
-#define UART_TX_BUFFER_SIZE 10
+#ifndef INC_SHELL_H_
+#define INC_SHELL_H_
+
+#include "main.h"
+
+#define UART_RX_BUFFER_SIZE 32		// block taken from the DMA ring (uart_rx.c) per read
+#define UART_TX_BUFFER_SIZE 128
 #define CMD_BUFFER_SIZE 64
+#define SHELL_PORT_COUNT 1			// sessions: USART2 (PC, ST-LINK), USART1 carries the binary protocol (protocol.c)
+#define SHELL_HASH_SIZE 128			// command lookup slots, power of two, at least twice the number of commands
 #define MAX_ARGS 9
 #define ASCII_LF 0x0A			// LF = line feed, saut de ligne
 #define ASCII_CR 0x0D			// CR = carriage return, retour chariot
 #define ASCII_BACK 0x08			// BACK = Backspace
 
+typedef struct shell_s shell_t;		// session of one UART, private to shell.c
+
+// argv[0] is the command name, argc counts it. Returns 0 on success, 1 to print the usage.
+typedef uint8_t (*shellHandler_t)(shell_t *shell, int argc, char **argv);
+// Completion of a deferred command. Returns 1 while still busy, 0 once the reply is sent.
+typedef uint8_t (*shellPoll_t)(shell_t *shell, void *context);
+
+typedef struct shellCommand_s {
+	const char *name;
+	shellHandler_t handler;
+	uint8_t minArgs;			// arguments after the name
+	uint8_t maxArgs;
+	const char *usage;			// argument spec, e.g. "<g> <dps>"
+	const char *help;			// one line for HELP
+}shellCommand_t;
+
+#define SHELL_CONCAT_(a, b)	a##b
+#define SHELL_CONCAT(a, b)	SHELL_CONCAT_(a, b)
+
+/**
+ * Register a command from any module, at file scope:
+ *     SHELL_COMMAND("GET_T", bmp280CmdGet, 0, 1, "[sensor]", "temperature");
+ * The descriptor lands in the .shell_cmd section (see the linker script),
+ * Shell_Init() indexes the whole section in a hash table.
+ */
+#define SHELL_COMMAND(cmdName, cmdHandler, cmdMinArgs, cmdMaxArgs, cmdUsage, cmdHelp) \
+	static const shellCommand_t SHELL_CONCAT(shellCommand_, __LINE__) \
+	__attribute__((section(".shell_cmd"), used, aligned(4))) = \
+	{ cmdName, cmdHandler, cmdMinArgs, cmdMaxArgs, cmdUsage, cmdHelp }
+
 void Shell_Init(void);
 void Shell_Loop(void);
+void Shell_Write(shell_t *shell, const uint8_t *data, uint16_t length);
+void Shell_Print(shell_t *shell, const char *format, ...);
+uint16_t Shell_Room(shell_t *shell);
+void Shell_Defer(shell_t *shell, shellPoll_t poll, void *context);
+uint8_t Shell_Busy(void);
+
+#endif /* INC_SHELL_H_ */
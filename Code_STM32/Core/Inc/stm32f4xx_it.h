@@ -57,6 +57,16 @@ void PendSV_Handler(void);
 void SysTick_Handler(void);
 void USART2_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
+void EXTI9_5_IRQHandler(void);
+void DMA1_Stream0_IRQHandler(void);
+void DMA1_Stream7_IRQHandler(void);
+void DMA1_Stream5_IRQHandler(void);
+void USART1_IRQHandler(void);
+void DMA2_Stream2_IRQHandler(void);
+void DMA1_Stream6_IRQHandler(void);
+void DMA2_Stream7_IRQHandler(void);
 
 /* USER CODE END EFP */
 
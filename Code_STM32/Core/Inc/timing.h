@@ -0,0 +1,32 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    timing.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   DWT cycle counter and microsecond clock used for on-target measurements
+ *
+ **/
+#ifndef INC_TIMING_H_
+#define INC_TIMING_H_
+
+#include "main.h"
+
+void timingInit(void);
+uint32_t timingMicros(void);
+uint32_t timingCyclesToUs(uint32_t cycles);
+void timingDelayUs(uint32_t us);
+
+/**
+ * @brief Read the DWT cycle counter (wraps every 2^32 core cycles).
+ */
+static inline uint32_t timingCycles(void) {
+	return DWT->CYCCNT;
+}
+
+#endif /* INC_TIMING_H_ */
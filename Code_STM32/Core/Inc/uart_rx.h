@@ -0,0 +1,38 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    uart_rx.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   UART reception by circular DMA, drained in bulk from the main loop
+ *
+ * The DMA writes every received byte into the ring by itself, the CPU is only
+ * interrupted on line idle and at half/full ring, i.e. once per burst.
+ *
+ **/
+#ifndef INC_UART_RX_H_
+#define INC_UART_RX_H_
+
+#include "main.h"
+
+#define UART_RX_RING_SIZE		256		// bytes per port, 22 ms of continuous traffic at 115200 baud
+#define UART_RX_PORT_COUNT		2		// USART1 (Raspberry Pi) and USART2 (ST-LINK)
+
+typedef struct uartRxStats_s {
+	uint32_t events;			// idle / half ring / full ring interrupts
+	uint32_t bytes;				// bytes written by the DMA
+	uint32_t overruns;			// bytes overwritten before being read
+	uint32_t restarts;			// reception restarted after a UART error
+	uint16_t maxLevel;			// highest ring level seen by uartRxRead()
+}uartRxStats_t;
+
+uint8_t uartRxInit(UART_HandleTypeDef *huart);
+uint16_t uartRxRead(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+const uartRxStats_t* uartRxGetStats(UART_HandleTypeDef *huart);
+
+#endif /* INC_UART_RX_H_ */
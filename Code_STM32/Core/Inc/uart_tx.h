@@ -0,0 +1,40 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    uart_tx.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   Non-blocking UART transmission, a ring per port drained by DMA
+ *
+ * uartTxWrite() copies the data and returns at once; the DMA completion
+ * interrupt starts the next contiguous chunk of the ring.
+ *
+ **/
+#ifndef INC_UART_TX_H_
+#define INC_UART_TX_H_
+
+#include "main.h"
+
+#define UART_TX_RING_SIZE		2048	// bytes per port, 178 ms of output at 115200 baud; longer dumps wait on Shell_Room()
+#define UART_TX_PORT_COUNT		2		// USART1 (Raspberry Pi) and USART2 (ST-LINK)
+
+typedef struct uartTxStats_s {
+	uint32_t bytes;				// bytes queued
+	uint32_t sent;				// bytes handed over by the DMA
+	uint32_t dropped;			// bytes refused, ring full
+	uint32_t transfers;			// DMA transfers started
+	uint32_t errors;			// DMA transfers aborted, their bytes are lost
+	uint16_t maxLevel;			// highest ring level
+}uartTxStats_t;
+
+uint8_t uartTxInit(UART_HandleTypeDef *huart);
+uint8_t uartTxWrite(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t len);
+uint16_t uartTxLevel(UART_HandleTypeDef *huart);
+const uartTxStats_t* uartTxGetStats(UART_HandleTypeDef *huart);
+
+#endif /* INC_UART_TX_H_ */
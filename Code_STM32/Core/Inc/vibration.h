@@ -0,0 +1,66 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    vibration.h
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   Block FFT of the accelerometer: spectral peaks and band RMS
+ *
+ * RAM: 5 float arrays of VIBRATION_MAX_SIZE (capture, FFT work, twiddles,
+ * window) plus the spectrum, about 18 KB for 1024 points. The cost of the
+ * last block is in vibrationReport_t.cycles (VIB command).
+ *
+ **/
+#ifndef INC_VIBRATION_H_
+#define INC_VIBRATION_H_
+
+#include "main.h"
+
+#define VIBRATION_MIN_SIZE		64
+#define VIBRATION_MAX_SIZE		1024	// points per block, power of 2
+#define VIBRATION_DEFAULT_SIZE	256		// 0.5 s at 500 Hz, 1.95 Hz resolution
+#define VIBRATION_MAX_PEAKS		8
+#define VIBRATION_DEFAULT_PEAKS	4
+#define VIBRATION_BANDS			4		// equal-width bands from 0 to fs/2
+#define VIBRATION_AXIS_NORM		3		// analyze |a| instead of one axis
+#define VIBRATION_CAN_ID_BANDS	0x70	// 4 x uint16 band RMS in mg
+#define VIBRATION_CAN_ID_PEAKS	0x71	// 0x71..0x74: 2 x (uint16 Hz x10, uint16 mg) per frame
+
+typedef enum vibrationWindow_e {
+	VIBRATION_WINDOW_RECT = 0,
+	VIBRATION_WINDOW_HANN,
+	VIBRATION_WINDOW_HAMMING,
+	VIBRATION_WINDOW_BLACKMAN,
+	VIBRATION_WINDOW_COUNT,
+}vibrationWindow_t;
+
+typedef struct vibrationPeak_s {
+	float freqHz;		// interpolated between bins
+	float amplitude;	// g, sine amplitude corrected for the window gain
+}vibrationPeak_t;
+
+typedef struct vibrationReport_s {
+	uint32_t blocks;					// blocks analyzed since the last configuration
+	uint16_t size;
+	vibrationWindow_t window;
+	uint8_t axis;						// 0..2, or VIBRATION_AXIS_NORM
+	float sampleRateHz;
+	float rms;							// g, DC removed
+	uint8_t peakCount;
+	vibrationPeak_t peaks[VIBRATION_MAX_PEAKS];	// highest first
+	float bandRms[VIBRATION_BANDS];		// g
+	uint32_t cycles;					// last block: window + FFT + peaks + bands
+	uint32_t canDropped;				// frames not sent, no free mailbox
+}vibrationReport_t;
+
+uint8_t vibrationConfigure(uint16_t size, vibrationWindow_t window, uint8_t axis, uint8_t peaks);
+void vibrationSample(const float accel[3], uint32_t periodUs);
+uint8_t vibrationProcess(void);
+const vibrationReport_t *vibrationGetReport(void);
+
+#endif /* INC_VIBRATION_H_ */
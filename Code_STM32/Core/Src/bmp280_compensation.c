@@ -0,0 +1,323 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    bmp280_compensation.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "BMP280/bmp280_compensation.h"
+
+const bmp280Calib_t bmp280RefCalib = {
+	.dig_T1 = 27504, .dig_T2 = 26435, .dig_T3 = -1000,
+	.dig_P1 = 36477, .dig_P2 = -10685, .dig_P3 = 3024,
+	.dig_P4 = 2855, .dig_P5 = 140, .dig_P6 = -7,
+	.dig_P7 = 15500, .dig_P8 = -14600, .dig_P9 = 6000,
+};
+
+/**
+ * @brief Compensate temperature in signed 32-bit format using BMP280 calibration data.
+ *
+ * This function compensates the raw temperature data obtained from the BMP280 sensor
+ * by applying calibration parameters. The compensated temperature is returned in
+ * signed 32-bit format.
+ *
+ * @param calib Calibration parameters cached in the device handle.
+ * @param adc_T Raw temperature reading.
+ * @param tFine Receives the fine temperature needed by the pressure compensation.
+ * @return Compensated temperature in 0.01 degC.
+ */
+BMP280_S32_t bmp280CompensateTInt32(const bmp280Calib_t *calib, BMP280_S32_t adc_T, BMP280_S32_t *tFine) {
+    BMP280_S32_t var1, var2;
+
+    var1 = ((((adc_T >> 3) - ((BMP280_S32_t)calib->dig_T1 << 1))) * (BMP280_S32_t)calib->dig_T2) >> 11;
+    var2 = (((((adc_T >> 4) - (BMP280_S32_t)calib->dig_T1) * ((adc_T >> 4) - (BMP280_S32_t)calib->dig_T1)) >> 12)
+            * (BMP280_S32_t)calib->dig_T3) >> 14;
+
+    *tFine = var1 + var2;
+    return (*tFine * 5 + 128) >> 8;
+}
+
+/**
+ * @brief Compensate pressure in 32-bit fixed point using BMP280 calibration data.
+ *
+ * Datasheet section 8.2 "32-bit integer" implementation. Cheapest of the
+ * integer paths, resolution is limited to 1 Pa.
+ *
+ * @param calib Calibration parameters cached in the device handle.
+ * @param adc_P Raw pressure reading.
+ * @param tFine Fine temperature computed from the same conversion.
+ * @return Compensated pressure in Pa, 0 if the calibration is invalid.
+ */
+BMP280_U32_t bmp280CompensatePInt32(const bmp280Calib_t *calib, BMP280_S32_t adc_P, BMP280_S32_t tFine) {
+    BMP280_S32_t var1, var2;
+    BMP280_U32_t p;
+
+    var1 = (tFine >> 1) - (BMP280_S32_t)64000;
+    var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * (BMP280_S32_t)calib->dig_P6;
+    var2 = var2 + ((var1 * (BMP280_S32_t)calib->dig_P5) << 1);
+    var2 = (var2 >> 2) + ((BMP280_S32_t)calib->dig_P4 << 16);
+    var1 = ((((BMP280_S32_t)calib->dig_P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3)
+            + (((BMP280_S32_t)calib->dig_P2 * var1) >> 1)) >> 18;
+    var1 = ((32768 + var1) * (BMP280_S32_t)calib->dig_P1) >> 15;
+
+    if (var1 == 0) {
+        // avoid exception caused by division by zero
+        return 0;
+    }
+
+    p = ((BMP280_U32_t)((BMP280_S32_t)1048576 - adc_P) - (BMP280_U32_t)(var2 >> 12)) * 3125U;
+
+    if (p < 0x80000000U) {
+        p = (p << 1) / (BMP280_U32_t)var1;
+    } else {
+        p = (p / (BMP280_U32_t)var1) << 1;
+    }
+
+    var1 = ((BMP280_S32_t)calib->dig_P9 * (BMP280_S32_t)(((p >> 3) * (p >> 3)) >> 13)) >> 12;
+    var2 = ((BMP280_S32_t)(p >> 2) * (BMP280_S32_t)calib->dig_P8) >> 13;
+    p = (BMP280_U32_t)((BMP280_S32_t)p + ((var1 + var2 + calib->dig_P7) >> 4));
+
+    return p;
+}
+
+/**
+ * @brief Datasheet 64-bit pressure compensation, shared by bmp280CompensatePInt64() and bmp280Compensate().
+ *
+ * x = tFine - 128000 fits in 32 bits, so the products of x alone are written
+ * (int64)a * b on 32-bit operands (SMULL on the M4). The products of the
+ * 64-bit intermediates stay 64x32, and the 64-bit division (__aeabi_ldivmod)
+ * dominates the cost.
+ * Bit-exact with the datasheet reference code.
+ */
+static inline BMP280_U32_t bmp280PressureInt64(const bmp280Calib_t *calib, BMP280_S32_t adc_P, BMP280_S32_t tFine) {
+    BMP280_S32_t x = tFine - 128000;
+    BMP280_S64_t xSq = (BMP280_S64_t)x * x;
+    BMP280_S64_t var1, var2, p;
+
+    var2 = xSq * calib->dig_P6;
+    var2 = var2 + (((BMP280_S64_t)x * calib->dig_P5) << 17);
+    var2 = var2 + ((BMP280_S64_t)calib->dig_P4 << 35);
+    var1 = ((xSq * calib->dig_P3) >> 8) + (((BMP280_S64_t)x * calib->dig_P2) << 12);
+    var1 = ((((BMP280_S64_t)1 << 47) + var1) * calib->dig_P1) >> 33;
+
+    if (var1 == 0) {
+        // avoid exception caused by division by zero
+        return 0;
+    }
+
+    p = 1048576 - adc_P;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = ((BMP280_S64_t)calib->dig_P9 * (p >> 13) * (p >> 13)) >> 25;
+    var2 = ((BMP280_S64_t)calib->dig_P8 * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + ((BMP280_S64_t)calib->dig_P7 << 4);
+
+    return (BMP280_U32_t)p;
+}
+
+/**
+ * @brief Compensate pressure in 64-bit fixed point using BMP280 calibration data.
+ *
+ * Datasheet section 3.11.3 implementation, 1/256 Pa resolution. About twice
+ * the cost of the 32-bit path on the M4 because of the 64-bit division
+ * (see BMP_BENCH).
+ *
+ * @param calib Calibration parameters cached in the device handle.
+ * @param adc_P Raw pressure reading.
+ * @param tFine Fine temperature computed from the same conversion.
+ * @return Compensated pressure in Q24.8 Pa (divide by 256 to get Pa), 0 if the calibration is invalid.
+ */
+BMP280_U32_t bmp280CompensatePInt64(const bmp280Calib_t *calib, BMP280_S32_t adc_P, BMP280_S32_t tFine) {
+    return bmp280PressureInt64(calib, adc_P, tFine);
+}
+
+/**
+ * @brief Compensate temperature in single precision floating point.
+ *
+ * Datasheet section 8.1 implementation, evaluated in float so that it runs
+ * on the Cortex-M4 FPU instead of the double precision software library.
+ *
+ * @param calib Calibration parameters cached in the device handle.
+ * @param adc_T Raw temperature reading.
+ * @param tFine Receives the fine temperature needed by the pressure compensation.
+ * @return Compensated temperature in degC.
+ */
+float bmp280CompensateTFloat(const bmp280Calib_t *calib, BMP280_S32_t adc_T, BMP280_S32_t *tFine) {
+    float var1, var2;
+
+    var1 = ((float)adc_T / 16384.0f - (float)calib->dig_T1 / 1024.0f) * (float)calib->dig_T2;
+    var2 = (float)adc_T / 131072.0f - (float)calib->dig_T1 / 8192.0f;
+    var2 = var2 * var2 * (float)calib->dig_T3;
+
+    *tFine = (BMP280_S32_t)(var1 + var2);
+    return (var1 + var2) / 5120.0f;
+}
+
+/**
+ * @brief Compensate pressure in single precision floating point.
+ *
+ * @param calib Calibration parameters cached in the device handle.
+ * @param adc_P Raw pressure reading.
+ * @param tFine Fine temperature computed from the same conversion.
+ * @return Compensated pressure in Pa, 0 if the calibration is invalid.
+ */
+float bmp280CompensatePFloat(const bmp280Calib_t *calib, BMP280_S32_t adc_P, BMP280_S32_t tFine) {
+    float var1, var2, p;
+
+    var1 = (float)tFine / 2.0f - 64000.0f;
+    var2 = var1 * var1 * (float)calib->dig_P6 / 32768.0f;
+    var2 = var2 + var1 * (float)calib->dig_P5 * 2.0f;
+    var2 = var2 / 4.0f + (float)calib->dig_P4 * 65536.0f;
+    var1 = ((float)calib->dig_P3 * var1 * var1 / 524288.0f + (float)calib->dig_P2 * var1) / 524288.0f;
+    var1 = (1.0f + var1 / 32768.0f) * (float)calib->dig_P1;
+
+    if (var1 == 0.0f) {
+        // avoid exception caused by division by zero
+        return 0.0f;
+    }
+
+    p = 1048576.0f - (float)adc_P;
+    p = (p - var2 / 4096.0f) * 6250.0f / var1;
+    var1 = (float)calib->dig_P9 * p * p / 2147483648.0f;
+    var2 = p * (float)calib->dig_P8 / 32768.0f;
+
+    return p + (var1 + var2 + (float)calib->dig_P7) / 16.0f;
+}
+
+/**
+ * @brief Compensate one raw sample with the path selected by BMP280_COMPENSATION.
+ *
+ * @param calib Calibration parameters cached in the device handle.
+ * @param adc_T Raw temperature reading.
+ * @param adc_P Raw pressure reading from the same conversion.
+ * @param meas Pointer to the structure receiving the compensated values.
+ * @return None
+ */
+void bmp280Compensate(const bmp280Calib_t *calib, BMP280_S32_t adc_T, BMP280_S32_t adc_P, bmp280Measure_t *meas) {
+    BMP280_S32_t tFine;
+
+#if (BMP280_COMPENSATION == BMP280_COMP_INT32)
+    meas->temperature = bmp280CompensateTInt32(calib, adc_T, &tFine);
+    meas->pressure = bmp280CompensatePInt32(calib, adc_P, tFine) << 8;
+#elif (BMP280_COMPENSATION == BMP280_COMP_INT64)
+    meas->temperature = bmp280CompensateTInt32(calib, adc_T, &tFine);
+    meas->pressure = bmp280PressureInt64(calib, adc_P, tFine);
+#elif (BMP280_COMPENSATION == BMP280_COMP_FLOAT)
+    float t = bmp280CompensateTFloat(calib, adc_T, &tFine);
+    meas->temperature = (BMP280_S32_t)(t * 100.0f + (t < 0.0f ? -0.5f : 0.5f));
+    meas->pressure = (BMP280_U32_t)(bmp280CompensatePFloat(calib, adc_P, tFine) * 256.0f + 0.5f);
+#else
+#error "BMP280_COMPENSATION must be BMP280_COMP_INT32, BMP280_COMP_INT64 or BMP280_COMP_FLOAT"
+#endif
+}
+
+/**
+ * @brief Compensate a block of raw samples with the 64-bit path.
+ *
+ * Structure-of-arrays version of bmp280CompensateTInt32() +
+ * bmp280CompensatePInt64() for samples buffered at high rate and compensated
+ * later, bit-exact with them whatever BMP280_COMPENSATION selects.
+ * The calibration words are sign-extended and the constant terms (dig_T1 << 1,
+ * dig_P4 << 35, dig_P7 << 4) computed once before the loop. Per sample, the
+ * tFine terms (x, x^2, the dig_P1..P3 divisor) are computed once, the products
+ * of x are 32x32->64 (SMULL/SMLAL on the M4) and one 64-bit division is left,
+ * which dominates the cost (see BMP_BENCH and Tests/test_bmp280.c).
+ * Outputs use the units of bmp280Measure_t (0.01 degC, Q24.8 Pa).
+ *
+ * @param calib Calibration parameters cached in the device handle.
+ * @param adcT Raw temperature readings.
+ * @param adcP Raw pressure readings, adcP[i] from the same conversion as adcT[i].
+ * @param temperature Receives n compensated temperatures.
+ * @param pressure Receives n compensated pressures, 0 if the calibration is invalid.
+ * @param n Number of samples.
+ * @return None
+ */
+void bmp280CompensateBatch(const bmp280Calib_t *calib, const BMP280_S32_t *adcT, const BMP280_S32_t *adcP,
+                           BMP280_S32_t *temperature, BMP280_U32_t *pressure, uint32_t n) {
+    const BMP280_S32_t t1 = calib->dig_T1;
+    const BMP280_S32_t t1x2 = t1 << 1;
+    const BMP280_S32_t t2 = calib->dig_T2;
+    const BMP280_S32_t t3 = calib->dig_T3;
+    const BMP280_S64_t p1 = calib->dig_P1;
+    const BMP280_S32_t p2 = calib->dig_P2;
+    const BMP280_S64_t p3 = calib->dig_P3;
+    const BMP280_S64_t p4 = (BMP280_S64_t)calib->dig_P4 << 35;
+    const BMP280_S32_t p5 = calib->dig_P5;
+    const BMP280_S64_t p6 = calib->dig_P6;
+    const BMP280_S64_t p7 = (BMP280_S64_t)calib->dig_P7 << 4;
+    const BMP280_S64_t p8 = calib->dig_P8;
+    const BMP280_S64_t p9 = calib->dig_P9;
+
+    for (uint32_t i = 0; i < n; i++) {
+        BMP280_S32_t dT = (adcT[i] >> 4) - t1;
+        BMP280_S32_t tFine = ((((adcT[i] >> 3) - t1x2) * t2) >> 11) + ((((dT * dT) >> 12) * t3) >> 14);
+        BMP280_S32_t x = tFine - 128000;
+        BMP280_S64_t xSq = (BMP280_S64_t)x * x;
+        BMP280_S64_t var1, var2, p;
+
+        temperature[i] = (tFine * 5 + 128) >> 8;
+
+        var2 = xSq * p6 + (((BMP280_S64_t)x * p5) << 17) + p4;
+        var1 = ((xSq * p3) >> 8) + (((BMP280_S64_t)x * p2) << 12);
+        var1 = ((((BMP280_S64_t)1 << 47) + var1) * p1) >> 33;
+        if (var1 == 0) {
+            pressure[i] = 0; /**< Invalid calibration, as the single sample path */
+            continue;
+        }
+
+        p = 1048576 - adcP[i];
+        p = (((p << 31) - var2) * 3125) / var1;
+        var1 = (p9 * (p >> 13) * (p >> 13)) >> 25;
+        var2 = (p8 * p) >> 19;
+        pressure[i] = (BMP280_U32_t)(((p + var1 + var2) >> 8) + p7);
+    }
+}
+
+/**
+ * @brief Check every compensation path against the datasheet reference vector.
+ *
+ * Uses the worked example of datasheet section 3.12 (adc_T = 519888,
+ * adc_P = 415148, 25.08 degC and 100653.27 Pa). The integer paths must
+ * reproduce the datasheet reference code bit for bit: 100656 Pa for the
+ * 32-bit path and 25767233 (100653.25 Pa) for the 64-bit and batch paths.
+ *
+ * @return 0 if all paths match, otherwise a bit mask of the failing paths
+ *         (bit BMP280_COMP_INT32, BMP280_COMP_INT64, BMP280_COMP_FLOAT).
+ */
+uint8_t bmp280SelfTest(void) {
+    const BMP280_S32_t adcT = BMP280_REF_ADC_T;
+    const BMP280_S32_t adcP = BMP280_REF_ADC_P;
+    BMP280_S32_t tFine, tFineF, tBatch;
+    BMP280_U32_t pBatch;
+    uint8_t failed = 0;
+    float t, p;
+
+    if (bmp280CompensateTInt32(&bmp280RefCalib, BMP280_REF_ADC_T, &tFine) != 2508 || tFine != 128422) {
+        failed |= (1 << BMP280_COMP_INT32) | (1 << BMP280_COMP_INT64);
+    }
+    if (bmp280CompensatePInt32(&bmp280RefCalib, BMP280_REF_ADC_P, tFine) != 100656U) {
+        failed |= (1 << BMP280_COMP_INT32);
+    }
+    if (bmp280CompensatePInt64(&bmp280RefCalib, BMP280_REF_ADC_P, tFine) != 25767233U) {
+        failed |= (1 << BMP280_COMP_INT64);
+    }
+    bmp280CompensateBatch(&bmp280RefCalib, &adcT, &adcP, &tBatch, &pBatch, 1);
+    if (tBatch != 2508 || pBatch != 25767233U) {
+        failed |= (1 << BMP280_COMP_INT64);
+    }
+
+    t = bmp280CompensateTFloat(&bmp280RefCalib, BMP280_REF_ADC_T, &tFineF);
+    p = bmp280CompensatePFloat(&bmp280RefCalib, BMP280_REF_ADC_P, tFineF);
+    if (t < 25.07f || t > 25.09f || p < 100652.77f || p > 100653.77f) {
+        failed |= (1 << BMP280_COMP_FLOAT);
+    }
+
+    return failed;
+}
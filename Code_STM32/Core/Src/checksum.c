@@ -0,0 +1,77 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    checksum.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include <string.h>
+#include "checksum.h"
+
+/**
+ * @brief CRC-32 of a buffer with the CRC unit.
+ *
+ * The F4 unit only implements the Ethernet polynomial (0x04C11DB7), initial
+ * value 0xFFFFFFFF, fed one 32-bit word at a time with no reflection and no
+ * final XOR. A trailing partial word is zero-padded. Not reentrant: call it
+ * from thread context only.
+ *
+ * @param data Buffer to checksum, any alignment.
+ * @param len Number of bytes.
+ * @return CRC register value after the last word.
+ */
+uint32_t checksumCrc32(const void *data, uint32_t len) {
+    const uint8_t *bytes = data;
+    uint32_t word;
+
+    __HAL_RCC_CRC_CLK_ENABLE();
+    CRC->CR = CRC_CR_RESET;
+
+    for (; len >= 4; len -= 4, bytes += 4) {
+        memcpy(&word, bytes, 4);
+        CRC->DR = word;
+    }
+    if (len > 0) {
+        word = 0;
+        memcpy(&word, bytes, len);
+        CRC->DR = word;
+    }
+
+    return CRC->DR;
+}
+
+/**
+ * @brief CRC-16/CCITT-FALSE of a buffer (polynomial 0x1021, initial value 0xFFFF).
+ *
+ * The F4 CRC unit is fixed to the 32-bit polynomial, this one runs in software
+ * with a 16-entry table, one nibble at a time. Same result as Python's
+ * binascii.crc_hqx(data, 0xFFFF). Reentrant.
+ *
+ * @param data Buffer to checksum.
+ * @param len Number of bytes.
+ * @return The CRC.
+ */
+uint16_t checksumCrc16(const void *data, uint32_t len) {
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    };
+    const uint8_t *bytes = data;
+    uint16_t crc = 0xFFFF;
+
+    while (len--) {
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (*bytes >> 4)];
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (*bytes & 0x0F)];
+        bytes++;
+    }
+    return crc;
+}
@@ -14,7 +14,10 @@
  **/
 
 #include "main.h"
-#include "i2c.h"
+#include <stdlib.h>
+#include "timing.h"
+#include "i2c_bus.h"
+#include "shell.h"
 #include "log/logger.h"
 
 #include "BMP280/BMP280_register.h"
@@ -45,9 +48,57 @@ enum {
 	TEMPERATURE_OVERSAMPLING_16,
 };
 
+enum {
+	FILTER_OFF = 0,
+	FILTER_2,
+	FILTER_4,
+	FILTER_8,
+	FILTER_16,
+};
+
+enum {
+	STANDBY_0_5_MS = 0,
+	STANDBY_62_5_MS,
+	STANDBY_125_MS,
+	STANDBY_250_MS,
+	STANDBY_500_MS,
+	STANDBY_1000_MS,
+	STANDBY_2000_MS,
+	STANDBY_4000_MS,
+};
+
+typedef struct bmp280ProfileCfg_s {
+	uint8_t osrsT;
+	uint8_t osrsP;
+	uint8_t filter;
+	uint8_t standby;
+}bmp280ProfileCfg_t;
+
+/**< Settings of each profile, see datasheet section 3.8 "Recommended modes of operation" */
+static const bmp280ProfileCfg_t bmp280Profiles[BMP280_PROFILE_COUNT] = {
+	[BMP280_PROFILE_ULTRA_LOW_POWER] = {TEMPERATURE_OVERSAMPLING_1, PRESSURE_OVERSAMPLING_1,  FILTER_OFF, STANDBY_4000_MS},
+	[BMP280_PROFILE_STANDARD]        = {TEMPERATURE_OVERSAMPLING_1, PRESSURE_OVERSAMPLING_4,  FILTER_4,   STANDBY_125_MS},
+	[BMP280_PROFILE_HIGH_RESOLUTION] = {TEMPERATURE_OVERSAMPLING_2, PRESSURE_OVERSAMPLING_16, FILTER_16,  STANDBY_0_5_MS},
+	[BMP280_PROFILE_MAX_RATE]        = {TEMPERATURE_OVERSAMPLING_1, PRESSURE_OVERSAMPLING_1,  FILTER_OFF, STANDBY_0_5_MS},
+};
+
+static const uint16_t bmp280OversamplingFactor[] = {0, 1, 2, 4, 8, 16};
+static const uint32_t bmp280StandbyUs[] = {500, 62500, 125000, 250000, 500000, 1000000, 2000000, 4000000};
+
+#define BMP280_FORCED_MARGIN_MS		2	// added to the conversion time when polling 'measuring'
+
+#define BMP280_BENCH_LOOPS			100
+
+static BMP280_S32_t bmp280BenchAdcT[BMP280_BENCH_LOOPS];
+static BMP280_S32_t bmp280BenchAdcP[BMP280_BENCH_LOOPS];
+static BMP280_S32_t bmp280BenchT[BMP280_BENCH_LOOPS];
+static BMP280_U32_t bmp280BenchP[BMP280_BENCH_LOOPS];
+
+
+#define BMP280_RAW20(msb, lsb, xlsb)	((BMP280_S32_t)(((uint32_t)(msb) << 12) | ((uint32_t)(lsb) << 4) | ((uint32_t)(xlsb) >> 4)))
 
-BMP280_S32_t tFine;
-float tFine_f;
+bmp280_t hbmp280[BMP280_MAX_DEVICES];
+uint8_t bmp280Count;
 
 /**
  * @brief Get the BMP280 sensor ID.
@@ -56,83 +107,263 @@ float tFine_f;
  * an I2C communication to read the sensor's ID register. The ID is
  * stored in the provided memory location pointed to by the 'id' parameter.
  *
+ * @param bmp Pointer to the BMP280 handle (bus and address).
  * @param id Pointer to the memory location where the BMP280 sensor ID will be stored.
  * @return 0 if successful, 1 if an error occurs during I2C communication.
  *
- * @note This function assumes that the I2C hardware (hi2c1) is already initialized
+ * @note This function assumes that the I2C hardware (bmp->hi2c) is already initialized
  *       and the BMP280 sensor is connected and properly configured.
  */
-uint8_t bmp280GetId(uint8_t *id) {
-    uint8_t reg = BMP280_REG_ID; /**< Register address for BMP280 sensor ID */
+uint8_t bmp280GetId(bmp280_t *bmp, uint8_t *id) {
+    if (i2cBusRead(bmp->hi2c, bmp->address, BMP280_REG_ID, id, 1) != 0) {
+        return 1; /**< Return error code if I2C read fails */
+    }
 
-    if (HAL_I2C_Master_Transmit(&hi2c1, BMP280_ADRESS, &reg, 1, HAL_MAX_DELAY) != HAL_OK) {
-        return 1; /**< Return error code if I2C transmit fails */
+    return 0; /**< Return 0 if the operation is successful */
+}
+
+/**
+ * @brief Write one BMP280 register.
+ *
+ * @param bmp Pointer to the BMP280 handle.
+ * @param reg Register address.
+ * @param value Value to write.
+ * @return 0 if successful, 1 if an error occurs during I2C communication.
+ */
+static uint8_t bmp280WriteReg(bmp280_t *bmp, uint8_t reg, uint8_t value) {
+    if (i2cBusWrite(bmp->hi2c, bmp->address, reg, &value, 1) != 0) {
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Compute the maximum conversion time of a profile.
+ *
+ * t_measure,max = 1.25 ms + 2.3 ms * osrs_t + (2.3 ms * osrs_p + 0.575 ms),
+ * see datasheet appendix B "Measurement time and current calculation".
+ *
+ * @param profile Measurement profile.
+ * @return Conversion time in microseconds, 0 for an unknown profile.
+ */
+uint32_t bmp280GetConversionTimeUs(bmp280Profile_t profile) {
+    const bmp280ProfileCfg_t *cfg;
+    uint32_t t = 1250;
+
+    if (profile >= BMP280_PROFILE_COUNT) {
+        return 0;
     }
+    cfg = &bmp280Profiles[profile];
 
-    if (HAL_I2C_Master_Receive(&hi2c1, BMP280_ADRESS, id, 1, HAL_MAX_DELAY) != HAL_OK) {
-        return 1; /**< Return error code if I2C receive fails */
+    t += 2300U * bmp280OversamplingFactor[cfg->osrsT];
+    if (cfg->osrsP != PRESSURE_OVERSAMPLING_SKIPPED) {
+        t += 2300U * bmp280OversamplingFactor[cfg->osrsP] + 575U;
     }
 
-    return 0; /**< Return 0 if the operation is successful */
+    return t;
 }
 
 /**
  * @brief Configure BMP280 sensor settings.
  *
- * This function configures the BMP280 sensor by setting the control measurement
- * register with specific oversampling rates for pressure and temperature, as well
- * as the operating mode.
+ * This function applies the measurement profile of the handle: oversampling
+ * rates, IIR filter and standby time, then starts normal mode. The sensor is
+ * put to sleep first because writes to 'config' may be ignored in normal mode.
  *
+ * @param bmp Pointer to the BMP280 handle.
  * @return 0 if successful, 1 if an error occurs during I2C communication.
  *
- * @note This function assumes that the I2C hardware (hi2c1) is already initialized
+ * @note This function assumes that the I2C hardware (bmp->hi2c) is already initialized
  *       and the BMP280 sensor is connected and properly configured.
  */
-uint8_t bmp280Config(void) {
-    uint8_t reg[2] = {
-        BMP280_REG_CTRL_MEAS,
-        ((PRESSURE_OVERSAMPLING_2 << 5) | (TEMPERATURE_OVERSAMPLING_16 << 2) | NORMAL_MODE)
-    }; /**< Control measurement register configuration */
+uint8_t bmp280Config(bmp280_t *bmp) {
+    const bmp280ProfileCfg_t *cfg;
+    uint8_t ctrlMeas;
+
+    if (bmp->profile >= BMP280_PROFILE_COUNT) {
+        return 1;
+    }
+    cfg = &bmp280Profiles[bmp->profile];
+    ctrlMeas = (cfg->osrsT << BMP280_OSRS_T_POS) | (cfg->osrsP << BMP280_OSRS_P_POS);
 
-    if (HAL_I2C_Master_Transmit(&hi2c1, BMP280_ADRESS, reg, 2, HAL_MAX_DELAY) != HAL_OK) {
+    if (bmp280WriteReg(bmp, BMP280_REG_CTRL_MEAS, ctrlMeas | SLEEP_MODE) != 0) {
         return 1; /**< Return error code if I2C transmit fails */
     }
+    if (bmp280WriteReg(bmp, BMP280_REG_CONFIG, (cfg->standby << BMP280_STBY_POS) | (cfg->filter << BMP280_FILTER_POS)) != 0) {
+        return 1;
+    }
+    if (bmp280WriteReg(bmp, BMP280_REG_CTRL_MEAS, ctrlMeas | NORMAL_MODE) != 0) {
+        return 1;
+    }
+
+    bmp->conversionTimeUs = bmp280GetConversionTimeUs(bmp->profile);
+    bmp->samplePeriodUs = bmp->conversionTimeUs + bmp280StandbyUs[cfg->standby];
 
     return 0; /**< Return 0 if the operation is successful */
 }
 
+/**
+ * @brief Select a measurement profile.
+ *
+ * @param bmp Pointer to the BMP280 handle.
+ * @param profile Profile to apply.
+ * @return 0 if successful, 1 if the profile is unknown or the I2C write fails.
+ */
+uint8_t bmp280SetProfile(bmp280_t *bmp, bmp280Profile_t profile) {
+    if (profile >= BMP280_PROFILE_COUNT) {
+        return 1;
+    }
+
+    bmp->profile = profile;
+
+    return bmp280Config(bmp);
+}
+
+/**
+ * @brief Trigger one forced-mode conversion and read its result.
+ *
+ * This function starts a single conversion with the oversampling of the
+ * current profile, polls the 'measuring' bit of the status register until
+ * the conversion is done, then reads and compensates the result. The sensor
+ * is left in sleep mode; call bmp280Config() to go back to normal mode.
+ *
+ * @param bmp Pointer to a BMP280 handle initialized with bmp280Init().
+ * @param meas Pointer to the structure receiving the compensated values.
+ * @return 0 if successful, 1 on I2C error or if the conversion does not complete in time.
+ */
+uint8_t bmp280ForcedMeasure(bmp280_t *bmp, bmp280Measure_t *meas) {
+    const bmp280ProfileCfg_t *cfg = &bmp280Profiles[bmp->profile];
+    uint32_t deadline = bmp280GetConversionTimeUs(bmp->profile) / 1000U + BMP280_FORCED_MARGIN_MS;
+    uint32_t start;
+    uint8_t status;
+
+    if (bmp280WriteReg(bmp, BMP280_REG_CTRL_MEAS, (cfg->osrsT << BMP280_OSRS_T_POS)
+                       | (cfg->osrsP << BMP280_OSRS_P_POS) | FORCED_MODE1) != 0) {
+        return 1;
+    }
+
+    start = HAL_GetTick();
+    do {
+        if (i2cBusRead(bmp->hi2c, bmp->address, BMP280_REG_STATUS, &status, 1) != 0) {
+            return 1;
+        }
+        if ((HAL_GetTick() - start) > deadline) {
+            bmp->stats.timeouts++;
+            return 1;
+        }
+    } while (status & BMP280_STATUS_MEASURING);
+
+    return bmp280GetMeasure(bmp, meas);
+}
+
 /**
  * @brief Retrieve calibration data from BMP280 sensor.
  *
- * This function reads calibration data from BMP280 sensor registers
- * and stores it in the provided BMP280 structure for future use in
- * temperature and pressure calculations.
+ * This function reads the trimming parameters dig_T1..dig_P9 (calib00..calib23)
+ * in a single auto-increment burst and stores them, typed and sign-extended as
+ * specified by the datasheet, in the provided BMP280 structure.
  *
  * @param bmp Pointer to the BMP280 structure where calibration data will be stored.
  * @return 0 if successful, 1 if an error occurs during I2C communication.
  *
- * @note This function assumes that the I2C hardware (hi2c1) is already initialized
+ * @note This function assumes that the I2C hardware (bmp->hi2c) is already initialized
  *       and the BMP280 sensor is connected and properly configured.
  */
-uint8_t bmp280GetCalib(bmp280Struct_t *bmp) {
-    uint8_t reg;
-    uint8_t buf[2];
+uint8_t bmp280GetCalib(bmp280_t *bmp) {
+    uint8_t buf[BMP280_CALIB_SIZE];
+    uint16_t word[BMP280_CALIB_SIZE / 2];
 
-    for (int i = BMP280_REG_CALIB00; i <= BMP280_REG_CALIB25; i += 2) {
-        reg = i;
+    if (i2cBusRead(bmp->hi2c, bmp->address, BMP280_REG_CALIB00, buf, BMP280_CALIB_SIZE) != 0) {
+        return 1; /**< Return error code if I2C read fails */
+    }
 
-        if (HAL_I2C_Master_Transmit(&hi2c1, BMP280_ADRESS, &reg, 1, HAL_MAX_DELAY) != HAL_OK) {
-            return 1; /**< Return error code if I2C transmit fails */
-        }
+    for (int i = 0; i < BMP280_CALIB_SIZE / 2; i++) {
+        word[i] = (uint16_t)(buf[2 * i] | (buf[2 * i + 1] << 8)); /**< Little-endian words */
+    }
 
-        if (HAL_I2C_Master_Receive(&hi2c1, BMP280_ADRESS, buf, 2, HAL_MAX_DELAY) != HAL_OK) {
-            return 1; /**< Return error code if I2C receive fails */
+    bmp->calib.dig_T1 = word[0];
+    bmp->calib.dig_T2 = (int16_t)word[1];
+    bmp->calib.dig_T3 = (int16_t)word[2];
+    bmp->calib.dig_P1 = word[3];
+    bmp->calib.dig_P2 = (int16_t)word[4];
+    bmp->calib.dig_P3 = (int16_t)word[5];
+    bmp->calib.dig_P4 = (int16_t)word[6];
+    bmp->calib.dig_P5 = (int16_t)word[7];
+    bmp->calib.dig_P6 = (int16_t)word[8];
+    bmp->calib.dig_P7 = (int16_t)word[9];
+    bmp->calib.dig_P8 = (int16_t)word[10];
+    bmp->calib.dig_P9 = (int16_t)word[11];
+    bmp->calibValid = 1;
+
+    return 0; /**< Return 0 if the operation is successful */
+}
+
+/**
+ * @brief Initialize a BMP280 device handle.
+ *
+ * This function binds the handle to its bus and address, configures the
+ * sensor with bmp->profile and caches its calibration data. Calibration never
+ * changes at runtime, so subsequent readings only transfer measurement
+ * registers.
+ *
+ * @param bmp Pointer to the BMP280 device handle to initialize.
+ * @param hi2c I2C bus the sensor is wired to.
+ * @param address BMP280_ADDRESS_SDO_GND or BMP280_ADDRESS_SDO_VDD.
+ * @return 0 if successful, 1 if an error occurs during I2C communication.
+ */
+uint8_t bmp280Init(bmp280_t *bmp, I2C_HandleTypeDef *hi2c, uint16_t address) {
+    bmp->hi2c = hi2c;
+    bmp->address = address;
+    bmp->calibValid = 0;
+    bmp->state = BMP280_STATE_IDLE;
+    bmp->timeout = BMP280_ASYNC_TIMEOUT_MS;
+
+    if (bmp280Config(bmp) != 0) {
+        return 1;
+    }
+
+    return bmp280GetCalib(bmp);
+}
+
+/**
+ * @brief Detect and initialize the BMP280 sensors of one I2C bus.
+ *
+ * Both addresses (SDO to GND and SDO to VDD) are probed. Each sensor that
+ * answers with a BMP280 chip ID is initialized with BMP280_DEFAULT_PROFILE
+ * in the next free slot of hbmp280[].
+ *
+ * @param hi2c I2C bus to scan.
+ * @return Number of sensors found on this bus.
+ */
+uint8_t bmp280Probe(I2C_HandleTypeDef *hi2c) {
+    static const uint16_t addresses[] = {BMP280_ADDRESS_SDO_GND, BMP280_ADDRESS_SDO_VDD};
+    uint8_t found = 0;
+    uint8_t id;
+
+    for (int i = 0; i < 2 && bmp280Count < BMP280_MAX_DEVICES; i++) {
+        bmp280_t *bmp = &hbmp280[bmp280Count];
+
+        bmp->hi2c = hi2c;
+        bmp->address = addresses[i];
+        if (!i2cBusIsReady(hi2c, addresses[i])) {
+            continue; /**< Nobody at this address, not a bus fault */
+        }
+        if (bmp280GetId(bmp, &id) != 0) {
+            continue;
+        }
+        if (id != BMP280_CHIP_ID1 && id != BMP280_CHIP_ID2 && id != BMP280_CHIP_ID3) {
+            continue;
         }
 
-        bmp->calibration[(i - BMP280_REG_CALIB00) / 2] = (buf[0] | (buf[1] << 8));
+        bmp->profile = BMP280_DEFAULT_PROFILE;
+        if (bmp280Init(bmp, hi2c, addresses[i]) == 0) {
+            bmp280Count++;
+            found++;
+        }
     }
 
-    return 0; /**< Return 0 if the operation is successful */
+    return found;
 }
 
 /**
@@ -144,22 +375,17 @@ uint8_t bmp280GetCalib(bmp280Struct_t *bmp) {
  * @param bmp Pointer to the BMP280 structure where temperature data will be stored.
  * @return 0 if successful, 1 if an error occurs during I2C communication.
  *
- * @note This function assumes that the I2C hardware (hi2c1) is already initialized
+ * @note This function assumes that the I2C hardware (bmp->hi2c) is already initialized
  *       and the BMP280 sensor is connected and properly configured.
  */
-uint8_t bmp280GetTemperature(bmp280Struct_t *bmp) {
-    uint8_t reg[3] = {BMP280_REG_TEMP_MSB, BMP280_REG_TEMP_LSB, BMP280_REG_TEMP_XLSB};
+uint8_t bmp280GetTemperature(bmp280_t *bmp) {
     uint8_t buf[3];
 
-    if (HAL_I2C_Master_Transmit(&hi2c1, BMP280_ADRESS, reg, 3, HAL_MAX_DELAY) != HAL_OK) {
-        return 1; /**< Return error code if I2C transmit fails */
-    }
-
-    if (HAL_I2C_Master_Receive(&hi2c1, BMP280_ADRESS, buf, 3, HAL_MAX_DELAY) != HAL_OK) {
-        return 1; /**< Return error code if I2C receive fails */
+    if (i2cBusRead(bmp->hi2c, bmp->address, BMP280_REG_TEMP_MSB, buf, 3) != 0) {
+        return 1; /**< Return error code if I2C read fails */
     }
 
-    bmp->temperature = ((buf[0] << 12) | (buf[1] << 4) | (buf[2] >> 4));
+    bmp->temperature = BMP280_RAW20(buf[0], buf[1], buf[2]);
 
     return 0; /**< Return 0 if the operation is successful */
 }
@@ -173,141 +399,436 @@ uint8_t bmp280GetTemperature(bmp280Struct_t *bmp) {
  * @param bmp Pointer to the BMP280 structure where pressure data will be stored.
  * @return 0 if successful, 1 if an error occurs during I2C communication.
  *
- * @note This function assumes that the I2C hardware (hi2c1) is already initialized
+ * @note This function assumes that the I2C hardware (bmp->hi2c) is already initialized
  *       and the BMP280 sensor is connected and properly configured.
  */
-uint8_t bmp280GetPressure(bmp280Struct_t *bmp) {
-    uint8_t reg[3] = {BMP280_REG_PRESS_MSB, BMP280_REG_PRESS_LSB, BMP280_REG_PRESS_XLSB};
+uint8_t bmp280GetPressure(bmp280_t *bmp) {
     uint8_t buf[3];
 
-    if (HAL_I2C_Master_Transmit(&hi2c1, BMP280_ADRESS, reg, 3, HAL_MAX_DELAY) != HAL_OK) {
-        return 1; /**< Return error code if I2C transmit fails */
+    if (i2cBusRead(bmp->hi2c, bmp->address, BMP280_REG_PRESS_MSB, buf, 3) != 0) {
+        return 1; /**< Return error code if I2C read fails */
     }
 
-    if (HAL_I2C_Master_Receive(&hi2c1, BMP280_ADRESS, buf, 3, HAL_MAX_DELAY) != HAL_OK) {
-        return 1; /**< Return error code if I2C receive fails */
+    bmp->pressure = BMP280_RAW20(buf[0], buf[1], buf[2]);
+
+    return 0; /**< Return 0 if the operation is successful */
+}
+
+/**
+ * @brief Retrieve pressure and temperature data from BMP280 sensor.
+ *
+ * This function reads press_msb..temp_xlsb (0xF7..0xFC) in a single burst.
+ * The sensor shadows the data registers during a burst read, so both values
+ * are guaranteed to belong to the same conversion.
+ *
+ * @param bmp Pointer to the BMP280 structure where raw data will be stored.
+ * @return 0 if successful, 1 if an error occurs during I2C communication.
+ */
+uint8_t bmp280GetRaw(bmp280_t *bmp) {
+    uint8_t buf[6];
+
+    if (i2cBusRead(bmp->hi2c, bmp->address, BMP280_REG_PRESS_MSB, buf, 6) != 0) {
+        return 1; /**< Return error code if I2C read fails */
     }
 
-    bmp->pressure = ((buf[0] << 12) | (buf[1] << 4) | (buf[2] >> 4));
+    bmp->pressure = BMP280_RAW20(buf[0], buf[1], buf[2]);
+    bmp->temperature = BMP280_RAW20(buf[3], buf[4], buf[5]);
 
     return 0; /**< Return 0 if the operation is successful */
 }
 
 /**
- * @brief Compensate temperature in signed 32-bit format using BMP280 calibration data.
+ * @brief Acquire compensated temperature and pressure from one conversion.
+ *
+ * This function performs one 6-byte burst read and compensates both values.
+ * The t_fine produced by the temperature compensation is passed straight to
+ * the pressure compensation, so pressure never uses a stale temperature.
  *
- * This function compensates the raw temperature data obtained from the BMP280 sensor
- * by applying calibration parameters. The compensated temperature is returned in
- * signed 32-bit format.
+ * @param bmp Pointer to a BMP280 handle initialized with bmp280Init().
+ * @param meas Pointer to the structure receiving the compensated values.
+ * @return 0 if successful, 1 if an error occurs during I2C communication.
+ */
+uint8_t bmp280GetMeasure(bmp280_t *bmp, bmp280Measure_t *meas) {
+    uint32_t start = timingCycles();
+
+    if (bmp280GetRaw(bmp) != 0) {
+        bmp->stats.errors++;
+        return 1;
+    }
+
+    bmp280Compensate(&bmp->calib, bmp->temperature, bmp->pressure, meas);
+
+    bmp->stats.samples++;
+    bmp->stats.syncBlockedCycles = timingCycles() - start;
+
+    return 0;
+}
+
+/**
+ * @brief Completion of the queued burst read, from the I2C interrupt or i2cQueueProcess().
+ */
+static void bmp280RequestDone(i2cRequest_t *req) {
+    bmp280_t *bmp = (bmp280_t *)req->context;
+
+    if (bmp->state != BMP280_STATE_BUSY) {
+        return; /**< Aborted meanwhile */
+    }
+    if (req->status == HAL_OK) {
+        bmp->state = BMP280_STATE_READY;
+    }
+    else {
+        bmp->stats.errors++;
+        bmp->state = BMP280_STATE_ERROR;
+    }
+    if (bmp->callback != NULL) {
+        bmp->callback(bmp);
+    }
+}
+
+/**
+ * @brief Start a non-blocking acquisition.
  *
- * @param adc BMP280 structure containing the raw temperature data and calibration parameters.
- * @return Compensated temperature in signed 32-bit format.
+ * This function queues the 6-byte burst read of 0xF7..0xFC at
+ * I2C_QUEUE_PRIO_LOW and returns immediately: IMU traffic submitted later
+ * still runs first. The result is collected with bmp280PollMeasure();
+ * bmp->callback, if set, is called from the I2C interrupt on completion.
  *
- * @note This function assumes that the BMP280 sensor has been properly configured,
- *       and calibration data is available in the BMP280 structure.
+ * @param bmp Pointer to a BMP280 handle initialized with bmp280Init().
+ * @return 0 if the transfer is queued, 1 if one is already pending or the queue is full.
  */
-BMP280_S32_t bmp280CompensateTInt32(bmp280Struct_t adc) {
-    BMP280_S32_t var1, var2, T;
-    uint16_t dig_T1 = adc.calibration[0];
-    uint16_t dig_T2 = adc.calibration[1];
-    uint16_t dig_T3 = adc.calibration[2];
-
-    var1 = ((((adc.temperature >> 3) - ((int32_t)dig_T1 << 1))) * (int32_t)dig_T2) >> 11;
-    var2 = (((((adc.temperature >> 4) - (int32_t)dig_T1) * ((adc.temperature >> 4) - (int32_t)dig_T1)) >> 12)
-            * (int32_t)dig_T3) >> 14;
-
-    tFine = var1 + var2;
-    return (tFine * 5 + 128) >> 8;
+uint8_t bmp280StartMeasure(bmp280_t *bmp) {
+    uint32_t start = timingCycles();
+
+    if (bmp->state == BMP280_STATE_BUSY) {
+        return 1; /**< One acquisition at a time per sensor */
+    }
+
+    bmp->state = BMP280_STATE_BUSY;
+    bmp->startTick = HAL_GetTick();
+
+    bmp->request.devAddr = bmp->address;
+    bmp->request.reg = BMP280_REG_PRESS_MSB;
+    bmp->request.write = 0;
+    bmp->request.buf = bmp->rxBuf;
+    bmp->request.len = sizeof(bmp->rxBuf);
+    bmp->request.callback = bmp280RequestDone;
+    bmp->request.context = bmp;
+
+    if (i2cQueueSubmit(bmp->hi2c, &bmp->request, I2C_QUEUE_PRIO_LOW) != 0) {
+        bmp->state = BMP280_STATE_IDLE;
+        bmp->stats.errors++;
+        return 1;
+    }
+
+    bmp->startCycles = timingCycles() - start;
+
+    return 0;
 }
 
 /**
- * @brief Compensate pressure in signed 32-bit format using BMP280 calibration data.
+ * @brief Collect the result of a non-blocking acquisition.
  *
- * This function compensates the raw pressure data obtained from the BMP280 sensor
- * by applying calibration parameters. The compensated pressure is returned in
- * signed 32-bit format.
+ * Call this function from the main loop. It compensates the data once the
+ * transfer has completed and withdraws the request when it exceeds
+ * bmp->timeout, queue wait included. READY, ERROR and TIMEOUT are reported
+ * once, then the handle returns to IDLE.
+ *
+ * @param bmp Pointer to a BMP280 handle.
+ * @param meas Pointer to the structure receiving the compensated values when READY.
+ * @return The acquisition state.
+ */
+bmp280State_t bmp280PollMeasure(bmp280_t *bmp, bmp280Measure_t *meas) {
+    uint32_t start = timingCycles();
+    bmp280State_t state = bmp->state;
+
+    switch (state) {
+    case BMP280_STATE_BUSY:
+        if ((HAL_GetTick() - bmp->startTick) > bmp->timeout) {
+            if (i2cQueueCancel(bmp->hi2c, &bmp->request) == 0) {
+                bmp->state = BMP280_STATE_IDLE;
+                bmp->stats.timeouts++;
+                return BMP280_STATE_TIMEOUT;
+            }
+            state = bmp->state; /**< The transfer completed meanwhile */
+        }
+        if (state != BMP280_STATE_READY) {
+            return state;
+        }
+        /* fall through */
+    case BMP280_STATE_READY:
+        bmp->pressure = BMP280_RAW20(bmp->rxBuf[0], bmp->rxBuf[1], bmp->rxBuf[2]);
+        bmp->temperature = BMP280_RAW20(bmp->rxBuf[3], bmp->rxBuf[4], bmp->rxBuf[5]);
+        bmp280Compensate(&bmp->calib, bmp->temperature, bmp->pressure, meas);
+        bmp->state = BMP280_STATE_IDLE;
+        bmp->stats.samples++;
+        bmp->stats.asyncBlockedCycles = bmp->startCycles + (timingCycles() - start);
+        return BMP280_STATE_READY;
+
+    case BMP280_STATE_ERROR:
+        bmp->state = BMP280_STATE_IDLE; /**< The queue recovers the bus */
+        return BMP280_STATE_ERROR;
+
+    default:
+        return state;
+    }
+}
+
+/**
+ * @brief Abort a non-blocking acquisition.
  *
- * @param adc BMP280 structure containing the raw pressure data and calibration parameters.
- * @return Compensated pressure in signed 32-bit format.
+ * The request is withdrawn from the queue. If it is already on the bus, the
+ * queue recovers the bus from i2cQueueProcess() since the F4 HAL cannot
+ * abort a memory transfer.
  *
- * @note This function assumes that the BMP280 sensor has been properly configured,
- *       and calibration data is available in the BMP280 structure.
+ * @param bmp Pointer to the BMP280 handle owning the transfer.
+ * @return None
  */
-BMP280_S32_t bmp280CompensatePInt32(bmp280Struct_t adc) {
-    uint32_t v1, v2, p;
-    uint32_t dig_P1 = adc.calibration[3];
-    uint32_t dig_P2 = adc.calibration[4];
-    uint32_t dig_P3 = adc.calibration[5];
-    uint32_t dig_P4 = adc.calibration[6];
-    uint32_t dig_P5 = adc.calibration[7];
-    uint32_t dig_P6 = adc.calibration[8];
-    uint32_t dig_P7 = adc.calibration[9];
-    uint32_t dig_P8 = adc.calibration[10];
-    uint32_t dig_P9 = adc.calibration[11];
-
-    v1 = (((int32_t)tFine) >> 1) - (int32_t)64000;
-    v2 = (((v1 >> 2) * (v1 >> 2)) >> 11) * (dig_P6);
-    v2 = v2 + ((v1 * (dig_P5)) << 1);
-    v2 = (v2 >> 2) + ((dig_P4) << 16);
-    v1 = (((dig_P3 * (((v1 >> 2) * (v1 >> 2)) >> 13)) >> 3) + (((dig_P2) * v1) >> 1)) >> 18;
-    v1 = (((32768 + v1)) * (dig_P1)) >> 15;
-
-    if (v1 == 0) {
-        // avoid exception caused by division by zero
-        return 0;
+void bmp280AbortMeasure(bmp280_t *bmp) {
+    if (bmp->state == BMP280_STATE_BUSY) {
+        i2cQueueCancel(bmp->hi2c, &bmp->request);
     }
+    bmp->state = BMP280_STATE_IDLE;
+}
 
-    p = (((uint32_t)(((int32_t)1048576) - adc.pressure) - (uint32_t)(v2 >> 12))) * 3125U;
+/**
+ * @brief Measure the cost of each compensation path.
+ *
+ * Each path (temperature + pressure) is run BMP280_BENCH_LOOPS times on the
+ * reference vector and timed with the DWT cycle counter, then the same
+ * number of samples is compensated with one bmp280CompensateBatch() call.
+ *
+ * @param bench Pointer to the structure receiving the average cycles per call.
+ * @return None
+ */
+void bmp280Benchmark(bmp280Bench_t *bench) {
+    volatile BMP280_U32_t sink;
+    volatile float sinkF;
+    BMP280_S32_t tFine;
+    uint32_t start;
+
+    start = timingCycles();
+    for (int i = 0; i < BMP280_BENCH_LOOPS; i++) {
+        sink = bmp280CompensateTInt32(&bmp280RefCalib, BMP280_REF_ADC_T + i, &tFine);
+        sink = bmp280CompensatePInt32(&bmp280RefCalib, BMP280_REF_ADC_P + i, tFine);
+    }
+    bench->cyclesInt32 = (timingCycles() - start) / BMP280_BENCH_LOOPS;
 
-    if (p < 0x80000000U) {
-        p = (p << 1) / ((uint32_t)v1);
-    } else {
-        p = (p / (uint32_t)v1) << 1;
+    start = timingCycles();
+    for (int i = 0; i < BMP280_BENCH_LOOPS; i++) {
+        sink = bmp280CompensateTInt32(&bmp280RefCalib, BMP280_REF_ADC_T + i, &tFine);
+        sink = bmp280CompensatePInt64(&bmp280RefCalib, BMP280_REF_ADC_P + i, tFine);
     }
+    bench->cyclesInt64 = (timingCycles() - start) / BMP280_BENCH_LOOPS;
 
-    v1 = ((dig_P9) * ((int32_t)(((p >> 3) * (p >> 3)) >> 13))) >> 12;
-    v2 = (((int32_t)(p >> 2)) * (dig_P8)) >> 13;
-    p = (uint32_t)((int32_t)p + ((v1 + v2 + dig_P7) >> 4));
+    start = timingCycles();
+    for (int i = 0; i < BMP280_BENCH_LOOPS; i++) {
+        sinkF = bmp280CompensateTFloat(&bmp280RefCalib, BMP280_REF_ADC_T + i, &tFine);
+        sinkF = bmp280CompensatePFloat(&bmp280RefCalib, BMP280_REF_ADC_P + i, tFine);
+    }
+    bench->cyclesFloat = (timingCycles() - start) / BMP280_BENCH_LOOPS;
 
-    return p * 1000U;
+    for (int i = 0; i < BMP280_BENCH_LOOPS; i++) {
+        bmp280BenchAdcT[i] = BMP280_REF_ADC_T + i;
+        bmp280BenchAdcP[i] = BMP280_REF_ADC_P + i;
+    }
+    start = timingCycles();
+    bmp280CompensateBatch(&bmp280RefCalib, bmp280BenchAdcT, bmp280BenchAdcP,
+                          bmp280BenchT, bmp280BenchP, BMP280_BENCH_LOOPS);
+    bench->cyclesBatch = (timingCycles() - start) / BMP280_BENCH_LOOPS;
+    bench->batchSamplesPerSec = (bench->cyclesBatch != 0) ? SystemCoreClock / bench->cyclesBatch : 0;
+
+    (void)sink;
+    (void)sinkF;
 }
 
 /**
  * @brief Get compensated temperature from BMP280 sensor.
  *
- * This function retrieves the compensated temperature from the BMP280 sensor
- * by obtaining calibration data, reading raw temperature data, and applying
- * compensation calculations. The temperature is returned in floating-point format.
+ * This function acquires one measurement with bmp280GetMeasure() and returns
+ * its temperature in floating-point format.
  *
+ * @param bmp Pointer to a BMP280 handle initialized with bmp280Init().
  * @return Compensated temperature in degrees Celsius.
- *
- * @note This function assumes that the BMP280 sensor has been properly configured
- *       and is connected. Calibration data and temperature measurements are obtained
- *       using the corresponding BMP280 functions.
  */
-float bmp280GetCompensateTemp(void) {
-    bmp280Struct_t dev; /**< BMP280 structure to store calibration and temperature data */
-    bmp280GetCalib(&dev); /**< Obtain calibration data from BMP280 sensor */
-    bmp280GetTemperature(&dev); /**< Obtain raw temperature data from BMP280 sensor */
-    return bmp280CompensateTInt32(dev) / 100.0f; /**< Return compensated temperature in degrees Celsius */
+float bmp280GetCompensateTemp(bmp280_t *bmp) {
+    bmp280Measure_t meas = {0}; /**< Compensated pressure and temperature */
+    bmp280GetMeasure(bmp, &meas); /**< One burst read, one conversion */
+    return meas.temperature / 100.0f; /**< Return compensated temperature in degrees Celsius */
 }
 
 /**
  * @brief Get compensated pressure from BMP280 sensor.
  *
- * This function retrieves the compensated pressure from the BMP280 sensor
- * by obtaining calibration data, reading raw pressure data, and applying
- * compensation calculations. The pressure is returned in floating-point format.
+ * This function acquires one measurement with bmp280GetMeasure() and returns
+ * its pressure in floating-point format.
  *
+ * @param bmp Pointer to a BMP280 handle initialized with bmp280Init().
  * @return Compensated pressure in Pascals.
+ */
+float bmp280GetCompensatePress(bmp280_t *bmp) {
+    bmp280Measure_t meas = {0}; /**< Compensated pressure and temperature */
+    bmp280GetMeasure(bmp, &meas); /**< One burst read, one conversion */
+    return meas.pressure / 256.0f; /**< Q24.8 to Pascals */
+}
+
+/* Shell commands ------------------------------------------------------------*/
+
+static const char bmp280CmdError[] = "BMP280 error\r\n";
+
+/**
+ * @brief Sensor selected by the optional index argument argv[arg].
  *
- * @note This function assumes that the BMP280 sensor has been properly configured
- *       and is connected. Calibration data and pressure measurements are obtained
- *       using the corresponding BMP280 functions.
+ * @return The sensor, sensor 0 without the argument, NULL for a bad index.
  */
-float bmp280GetCompensatePress(void) {
-    bmp280Struct_t dev; /**< BMP280 structure to store calibration and pressure data */
-    bmp280GetCalib(&dev); /**< Obtain calibration data from BMP280 sensor */
-    bmp280GetPressure(&dev); /**< Obtain raw pressure data from BMP280 sensor */
-    return bmp280CompensatePInt32(dev) / 256.0f; /**< Return compensated pressure in Pascals */
+static bmp280_t *bmp280CmdSensor(int argc, char **argv, int arg) {
+    int index = (argc > arg) ? atoi(argv[arg]) : 0;
+
+    if (index < 0 || index >= bmp280Count) {
+        return NULL;
+    }
+    return &hbmp280[index];
 }
+
+/**
+ * @brief Completion of GET_T / GET_P, polled by the shell until it returns 0.
+ */
+static uint8_t bmp280CmdPoll(shell_t *shell, bmp280_t *bmp, char quantity) {
+    bmp280Measure_t meas;
+    bmp280State_t state = bmp280PollMeasure(bmp, &meas);
+
+    if (state == BMP280_STATE_BUSY) {
+        return 1;
+    }
+    if (state != BMP280_STATE_READY) {
+        Shell_Print(shell, bmp280CmdError);
+    }
+    else if (quantity == 'T') {
+        Shell_Print(shell, "T = %ld_C\n\r", meas.temperature / 100);
+    }
+    else {
+        Shell_Print(shell, "P = %ld Pa\n\r", (BMP280_S32_t)(meas.pressure / 256));
+    }
+    return 0;
+}
+
+static uint8_t bmp280CmdPollTemp(shell_t *shell, void *context) {
+    return bmp280CmdPoll(shell, context, 'T');
+}
+
+static uint8_t bmp280CmdPollPress(shell_t *shell, void *context) {
+    return bmp280CmdPoll(shell, context, 'P');
+}
+
+/**
+ * @brief GET_T / GET_P [sensor]: start an acquisition, the reply is sent on completion.
+ */
+static uint8_t bmp280CmdGet(shell_t *shell, int argc, char **argv) {
+    bmp280_t *bmp = bmp280CmdSensor(argc, argv, 1);
+
+    if (bmp == NULL || bmp280StartMeasure(bmp) != 0) {
+        Shell_Print(shell, bmp280CmdError);
+        return 0;
+    }
+    Shell_Defer(shell, argv[0][4] == 'T' ? bmp280CmdPollTemp : bmp280CmdPollPress, bmp);
+    return 0;
+}
+
+/**
+ * @brief BMP_STAT [sensor]: blocking time, compensation cost and error counters.
+ *
+ * GET_T/GET_P and the protocol only use the asynchronous path, so one
+ * blocking bmp280GetMeasure() is run here to compare both.
+ */
+static uint8_t bmp280CmdStat(shell_t *shell, int argc, char **argv) {
+    bmp280_t *bmp = bmp280CmdSensor(argc, argv, 1);
+    bmp280Measure_t meas;
+    bmp280Bench_t bench;
+
+    if (bmp == NULL) {
+        Shell_Print(shell, bmp280CmdError);
+        return 0;
+    }
+    if (bmp->state != BMP280_STATE_BUSY) {
+        bmp280GetMeasure(bmp, &meas); /**< Refreshes syncBlockedCycles */
+    }
+    bmp280Benchmark(&bench);
+    Shell_Print(shell, "bmp %d/%d @0x%02X: sync %lu us, async %lu us\n\r",
+            (int)(bmp - hbmp280), bmp280Count, bmp->address >> 1,
+            timingCyclesToUs(bmp->stats.syncBlockedCycles),
+            timingCyclesToUs(bmp->stats.asyncBlockedCycles));
+    Shell_Print(shell, "compensation cycles/sample: int32 %lu, int64 %lu, batch %lu\n\r",
+            bench.cyclesInt32, bench.cyclesInt64, bench.cyclesBatch);
+    Shell_Print(shell, "samples %lu, errors %lu, timeouts %lu\n\r",
+            bmp->stats.samples, bmp->stats.errors, bmp->stats.timeouts);
+    return 0;
+}
+
+/**
+ * @brief BMP_BENCH: compensation paths cost.
+ */
+static uint8_t bmp280CmdBench(shell_t *shell, int argc, char **argv) {
+    bmp280Bench_t bench;
+
+    bmp280Benchmark(&bench);
+    Shell_Print(shell, "selftest 0x%02X, path %d\n\r", bmp280SelfTest(), BMP280_COMPENSATION);
+    Shell_Print(shell, "cycles: int32 %lu, int64 %lu, float %lu\n\r",
+            bench.cyclesInt32, bench.cyclesInt64, bench.cyclesFloat);
+    Shell_Print(shell, "batch: %lu cycles/sample, %lu samples/s\n\r",
+            bench.cyclesBatch, bench.batchSamplesPerSec);
+    return 0;
+}
+
+/**
+ * @brief BMP_PROFILE <p> [sensor]: oversampling / filter profile.
+ */
+static uint8_t bmp280CmdProfile(shell_t *shell, int argc, char **argv) {
+    bmp280_t *bmp = bmp280CmdSensor(argc, argv, 2);
+
+    if (bmp == NULL || Shell_Busy() || bmp280SetProfile(bmp, atoi(argv[1])) != 0) {
+        Shell_Print(shell, bmp280CmdError);
+        return 0;
+    }
+    Shell_Print(shell, "profile %d: conversion %lu us, period %lu us\n\r",
+            bmp->profile, bmp->conversionTimeUs, bmp->samplePeriodUs);
+    return 0;
+}
+
+/**
+ * @brief I2C_BENCH [len]: same burst on the first BMP280 at each bus speed.
+ *
+ * The previous speed is restored afterwards.
+ */
+static uint8_t bmp280CmdBusBench(shell_t *shell, int argc, char **argv) {
+    static const uint32_t speeds[] = {I2C_BUS_SPEED_STANDARD, I2C_BUS_SPEED_FAST};
+    uint16_t len = (argc > 1) ? atoi(argv[1]) : 6;
+    i2cBusBench_t bench;
+    I2C_HandleTypeDef *hi2c;
+    uint32_t speed, duty;
+
+    if (bmp280Count == 0 || Shell_Busy()) {
+        Shell_Print(shell, bmp280CmdError);
+        return 0;
+    }
+    hi2c = hbmp280[0].hi2c;
+    speed = hi2c->Init.ClockSpeed;
+    duty = hi2c->Init.DutyCycle;
+    for (int i = 0; i < 2; i++) {
+        i2cBusSetSpeed(hi2c, speeds[i], duty);
+        if (i2cBusBenchmark(hi2c, hbmp280[0].address, BMP280_REG_PRESS_MSB, len, 100, &bench) == 0) {
+            Shell_Print(shell, "%lu Hz: %lu B/s, avg %lu us, max %lu us, %lu err\n\r",
+                    bench.speed, bench.bytesPerSec, bench.latencyAvgUs, bench.latencyMaxUs, bench.errors);
+        }
+        else {
+            Shell_Print(shell, "%lu Hz: failed\n\r", speeds[i]);
+        }
+    }
+    i2cBusSetSpeed(hi2c, speed, duty);
+    return 0;
+}
+
+SHELL_COMMAND("GET_T", bmp280CmdGet, 0, 1, "[sensor]", "temperature");
+SHELL_COMMAND("GET_P", bmp280CmdGet, 0, 1, "[sensor]", "pressure");
+SHELL_COMMAND("BMP_STAT", bmp280CmdStat, 0, 1, "[sensor]", "BMP280 timing and error counters");
+SHELL_COMMAND("BMP_BENCH", bmp280CmdBench, 0, 0, "", "BMP280 compensation benchmark");
+SHELL_COMMAND("BMP_PROFILE", bmp280CmdProfile, 1, 2, "<profile> [sensor]", "BMP280 oversampling profile");
+SHELL_COMMAND("I2C_BENCH", bmp280CmdBusBench, 0, 1, "[len]", "bus throughput at 100 and 400 kHz on the first BMP280");
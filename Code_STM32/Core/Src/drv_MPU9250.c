@@ -14,10 +14,1208 @@
  **/
 
 #include "main.h"
-#include "i2c.h"
-#include "usart.h"
-#include "gpio.h"
+#include <stdlib.h>
+#include <string.h>
+#include "timing.h"
+#include "i2c_bus.h"
+#include "flash_store.h"
+#include "shell.h"
 
-void mpu9250Init (void) {
-	
-}
\ No newline at end of file
+#include "MPU9250/MPU9250_register.h"
+#include "MPU9250/drv_MPU9250.h"
+
+typedef struct mpu9250ProfileCfg_s {
+    uint8_t dlpf;           /**< CONFIG DLPF_CFG */
+    uint8_t gyroFchoiceB;   /**< GYRO_CONFIG[1:0] */
+    uint8_t accelConfig2;   /**< ACCEL_CONFIG2: ACCEL_FCHOICE_B | A_DLPFCFG */
+    uint8_t rateDiv;        /**< SMPLRT_DIV, only used with DLPF_CFG 1..6 */
+    uint16_t periodUs;      /**< Resulting output data period */
+}mpu9250ProfileCfg_t;
+
+/**< Settings of each profile, see the register map, CONFIG and ACCEL_CONFIG2 tables */
+static const mpu9250ProfileCfg_t mpu9250Profiles[MPU9250_PROFILE_COUNT] = {
+    [MPU9250_PROFILE_200HZ]           = {3, 0x00, 3, 4, 5000},
+    [MPU9250_PROFILE_200HZ_LOW_NOISE] = {5, 0x00, 5, 4, 5000},
+    [MPU9250_PROFILE_500HZ]           = {2, 0x00, 2, 1, 2000},
+    [MPU9250_PROFILE_1KHZ]            = {3, 0x00, 3, 0, 1000},
+    [MPU9250_PROFILE_RAW_8KHZ]        = {MPU9250_DLPF_BYPASS, 0x00, MPU9250_ACCEL_FCHOICE_B, 0, 125},
+};
+
+/* Full-scale ranges, indexed by mpu9250AccelFs_t / mpu9250GyroFs_t */
+static const float mpu9250AccelRange[] = {2.0f, 4.0f, 8.0f, 16.0f};         /**< g */
+static const float mpu9250GyroRange[] = {250.0f, 500.0f, 1000.0f, 2000.0f}; /**< deg/s */
+
+mpu9250_t hmpu9250;
+
+static uint8_t mpu9250FifoReset(mpu9250_t *mpu);
+
+/**
+ * @brief Write one MPU9250 register.
+ *
+ * @param mpu Pointer to the MPU9250 handle.
+ * @param reg Register address.
+ * @param value Value to write.
+ * @return 0 if successful, 1 if an error occurs during I2C communication.
+ */
+static uint8_t mpu9250WriteReg(mpu9250_t *mpu, uint8_t reg, uint8_t value) {
+    return i2cBusWrite(mpu->hi2c, mpu->address, reg, &value, 1);
+}
+
+/**
+ * @brief Read the WHO_AM_I register.
+ *
+ * @param mpu Pointer to the MPU9250 handle (bus and address).
+ * @param id Pointer to the memory location where the ID will be stored (0x71 for an MPU9250).
+ * @return 0 if successful, 1 if an error occurs during I2C communication.
+ */
+uint8_t mpu9250GetId(mpu9250_t *mpu, uint8_t *id) {
+    return i2cBusRead(mpu->hi2c, mpu->address, WHO_AM_I_MPU9250, id, 1);
+}
+
+/**
+ * @brief Set the accelerometer and gyroscope full-scale ranges.
+ *
+ * The conversion factors are computed here once, so converting a sample
+ * only costs one multiplication per axis. The FIFO is flushed so that no
+ * frame of the previous range gets converted with the new factors.
+ *
+ * @param mpu Pointer to the MPU9250 handle.
+ * @param accelFs Accelerometer range.
+ * @param gyroFs Gyroscope range.
+ * @return 0 if successful, 1 if a range is invalid or on I2C error.
+ */
+uint8_t mpu9250SetFullScale(mpu9250_t *mpu, mpu9250AccelFs_t accelFs, mpu9250GyroFs_t gyroFs) {
+    if (accelFs > MPU9250_ACCEL_FS_16G || gyroFs > MPU9250_GYRO_FS_2000DPS) {
+        return 1;
+    }
+
+    if (mpu9250WriteReg(mpu, ACCEL_CONFIG, accelFs << MPU9250_ACCEL_FS_POS) != 0) {
+        return 1;
+    }
+    if (mpu9250WriteReg(mpu, GYRO_CONFIG, (gyroFs << MPU9250_GYRO_FS_POS) | mpu9250Profiles[mpu->profile].gyroFchoiceB) != 0) {
+        return 1;
+    }
+
+    mpu->accelFs = accelFs;
+    mpu->gyroFs = gyroFs;
+    mpu->accelScale = mpu9250AccelRange[accelFs] / 32768.0f;
+    mpu->gyroScale = mpu9250GyroRange[gyroFs] / 32768.0f;
+
+    return mpu->fifoEnabled ? mpu9250FifoReset(mpu) : 0;
+}
+
+/**
+ * @brief Write the filter and rate registers of mpu->profile.
+ *
+ * @param mpu Pointer to the MPU9250 handle.
+ * @return 0 if successful, 1 on I2C error.
+ */
+static uint8_t mpu9250ApplyProfile(mpu9250_t *mpu) {
+    const mpu9250ProfileCfg_t *cfg = &mpu9250Profiles[mpu->profile];
+    uint8_t config = cfg->dlpf & MPU9250_DLPF_MASK;
+
+    if (mpu->fifoEnabled) {
+        config |= MPU9250_CONFIG_FIFO_MODE;
+    }
+    if (mpu9250WriteReg(mpu, CONFIG, config) != 0
+            || mpu9250WriteReg(mpu, ACCEL_CONFIG2, cfg->accelConfig2) != 0
+            || mpu9250WriteReg(mpu, SMPLRT_DIV, cfg->rateDiv) != 0) {
+        return 1;
+    }
+
+    mpu->dlpf = cfg->dlpf;
+    mpu->sampleRateDiv = cfg->rateDiv;
+    mpu->samplePeriodUs = cfg->periodUs;
+
+    return mpu9250SetFullScale(mpu, mpu->accelFs, mpu->gyroFs); /**< GYRO_CONFIG holds FCHOICE_B */
+}
+
+/**
+ * @brief Select the output data rate and filter bandwidth.
+ *
+ * Pick the lowest rate the consumer needs: every sample costs a burst on the
+ * shared I2C bus. The raw profile outruns a 400 kHz bus and is only usable
+ * for short FIFO captures. The FIFO is flushed so that no frame of the
+ * previous rate gets timestamped with the new period. Scale factors do not
+ * change.
+ *
+ * @param mpu Pointer to an MPU9250 handle initialized with mpu9250Init().
+ * @param profile Profile to apply.
+ * @return 0 if successful, 1 if the profile is unknown or on I2C error.
+ */
+uint8_t mpu9250SetProfile(mpu9250_t *mpu, mpu9250Profile_t profile) {
+    if (profile >= MPU9250_PROFILE_COUNT) {
+        return 1;
+    }
+
+    mpu->profile = profile;
+
+    return mpu9250ApplyProfile(mpu); /**< Ends with mpu9250SetFullScale(), which flushes the FIFO */
+}
+
+/**
+ * @brief Initialize an MPU9250 device handle.
+ *
+ * This function resets the chip, selects the PLL clock, enables all axes,
+ * then applies the profile and full-scale ranges held by the handle. Fields
+ * left to 0 select 200 Hz with a 41 Hz DLPF, +-2 g and +-250 deg/s.
+ *
+ * @param mpu Pointer to the MPU9250 handle to initialize.
+ * @param hi2c I2C bus the IMU is wired to.
+ * @param address MPU9250_ADDRESS_AD0_LOW or MPU9250_ADDRESS_AD0_HIGH.
+ * @return 0 if successful, 1 on I2C error or if WHO_AM_I does not match.
+ */
+uint8_t mpu9250Init(mpu9250_t *mpu, I2C_HandleTypeDef *hi2c, uint16_t address) {
+    uint8_t id;
+
+    mpu->hi2c = hi2c;
+    mpu->address = address;
+    mpu->fifoEnabled = 0;
+    mpu->irqEnabled = 0;
+    mpu->magEnabled = 0;
+    mpu->womState = MPU9250_WOM_OFF;
+    mpu->userCtrl = 0;
+    mpu->burstSize = MPU9250_BURST_SIZE;
+    if (mpu->profile >= MPU9250_PROFILE_COUNT) {
+        mpu->profile = MPU9250_PROFILE_200HZ;
+    }
+
+    if (mpu9250GetId(mpu, &id) != 0) {
+        return 1;
+    }
+    if (id != MPU9250_WHO_AM_I_ID && id != MPU9255_WHO_AM_I_ID) {
+        return 1;
+    }
+
+    if (mpu9250WriteReg(mpu, PWR_MGMT_1, MPU9250_H_RESET) != 0) {
+        return 1;
+    }
+    HAL_Delay(MPU9250_RESET_DELAY_MS);
+
+    if (mpu9250WriteReg(mpu, PWR_MGMT_1, MPU9250_CLKSEL_PLL) != 0
+            || mpu9250WriteReg(mpu, PWR_MGMT_2, 0x00) != 0                /**< All axes on */
+            || mpu9250GetOffsets(mpu, &mpu->offsets) != 0) {            /**< Factory accel trim, gyro 0 */
+        return 1;
+    }
+
+    return mpu9250ApplyProfile(mpu);
+}
+
+/**
+ * @brief Configure the AK8963 as slave 0 of the MPU9250 I2C master.
+ *
+ * The fuse ROM sensitivity adjustment is read in bypass mode, the
+ * magnetometer is set to continuous 100 Hz 16-bit output, then the internal
+ * master reads HXL..ST2 after each sample into EXT_SENS_DATA_00..06, right
+ * after GYRO_ZOUT_L. The 9 axes then come in one burst (or FIFO frame) of
+ * 21 bytes. WAIT_FOR_ES holds data ready until the magnetometer data is in.
+ * Call it after mpu9250Init() and before mpu9250FifoEnable().
+ *
+ * @param mpu Pointer to an MPU9250 handle initialized with mpu9250Init().
+ * @return 0 if successful, 1 on I2C error or if the AK8963 does not answer.
+ */
+uint8_t mpu9250MagInit(mpu9250_t *mpu) {
+    uint8_t id;
+    uint8_t value;
+
+    mpu->magEnabled = 0;
+    mpu->burstSize = MPU9250_BURST_SIZE;
+    mpu->userCtrl &= ~MPU9250_USER_I2C_MST_EN;
+
+    if (mpu9250WriteReg(mpu, USER_CTRL, mpu->userCtrl) != 0
+            || mpu9250WriteReg(mpu, INT_PIN_CFG, MPU9250_INT_BYPASS_EN) != 0) {
+        return 1;
+    }
+
+    if (i2cBusRead(mpu->hi2c, AK8963_ADDRESS_8BIT, WHO_AM_I_AK8963, &id, 1) != 0 || id != AK8963_WHO_AM_I_ID) {
+        mpu9250WriteReg(mpu, INT_PIN_CFG, 0x00);
+        return 1;
+    }
+
+    value = AK8963_CNTL_POWER_DOWN;
+    i2cBusWrite(mpu->hi2c, AK8963_ADDRESS_8BIT, AK8963_CNTL, &value, 1);
+    HAL_Delay(AK8963_MODE_DELAY_MS);
+    value = AK8963_CNTL_FUSE_ROM;
+    i2cBusWrite(mpu->hi2c, AK8963_ADDRESS_8BIT, AK8963_CNTL, &value, 1);
+    HAL_Delay(AK8963_MODE_DELAY_MS);
+    if (i2cBusRead(mpu->hi2c, AK8963_ADDRESS_8BIT, AK8963_ASAX, mpu->magAsa, 3) != 0) {
+        return 1;
+    }
+    value = AK8963_CNTL_POWER_DOWN; /**< Fuse ROM to measurement goes through power-down */
+    i2cBusWrite(mpu->hi2c, AK8963_ADDRESS_8BIT, AK8963_CNTL, &value, 1);
+    HAL_Delay(AK8963_MODE_DELAY_MS);
+    value = AK8963_CNTL_CONT2_16BIT;
+    if (i2cBusWrite(mpu->hi2c, AK8963_ADDRESS_8BIT, AK8963_CNTL, &value, 1) != 0) {
+        return 1;
+    }
+    HAL_Delay(AK8963_MODE_DELAY_MS);
+
+    /* H_adj = H * ((ASA - 128) / 256 + 1), folded into the scale once */
+    for (int i = 0; i < 3; i++) {
+        mpu->magScale[i] = AK8963_SENSITIVITY * (((float)mpu->magAsa[i] - 128.0f) / 256.0f + 1.0f);
+    }
+
+    mpu->userCtrl |= MPU9250_USER_I2C_MST_EN;
+    if (mpu9250WriteReg(mpu, INT_PIN_CFG, 0x00) != 0
+            || mpu9250WriteReg(mpu, I2C_MST_CTRL, MPU9250_I2C_MST_WAIT_FOR_ES | MPU9250_I2C_MST_CLK_400K) != 0
+            || mpu9250WriteReg(mpu, I2C_SLV0_ADDR, MPU9250_I2C_SLV_READ | AK8963_ADDRESS) != 0
+            || mpu9250WriteReg(mpu, I2C_SLV0_REG, AK8963_XOUT_L) != 0
+            || mpu9250WriteReg(mpu, I2C_SLV0_CTRL, MPU9250_I2C_SLV_EN | MPU9250_MAG_SIZE) != 0
+            || mpu9250WriteReg(mpu, USER_CTRL, mpu->userCtrl) != 0) {
+        mpu->userCtrl &= ~MPU9250_USER_I2C_MST_EN;
+        return 1;
+    }
+
+    mpu->magEnabled = 1;
+    mpu->burstSize = MPU9250_BURST_SIZE_MAG;
+
+    return 0;
+}
+
+/**
+ * @brief Byte-swap one burst or FIFO frame into a raw sample.
+ *
+ * The MPU9250 stores every axis big-endian, high byte first; the AK8963
+ * data that follows is little-endian.
+ *
+ * @param mpu Pointer to the MPU9250 handle (magnetometer enabled or not).
+ * @param buf Burst starting at ACCEL_XOUT_H, mpu->burstSize bytes.
+ * @param raw Pointer to the structure receiving the values.
+ * @return None
+ */
+void mpu9250Unpack(const mpu9250_t *mpu, const uint8_t *buf, mpu9250Raw_t *raw) {
+    raw->accel[0] = (int16_t)((buf[0] << 8) | buf[1]);
+    raw->accel[1] = (int16_t)((buf[2] << 8) | buf[3]);
+    raw->accel[2] = (int16_t)((buf[4] << 8) | buf[5]);
+    raw->temperature = (int16_t)((buf[6] << 8) | buf[7]);
+    raw->gyro[0] = (int16_t)((buf[8] << 8) | buf[9]);
+    raw->gyro[1] = (int16_t)((buf[10] << 8) | buf[11]);
+    raw->gyro[2] = (int16_t)((buf[12] << 8) | buf[13]);
+
+    if (mpu->magEnabled) {
+        raw->mag[0] = (int16_t)((buf[15] << 8) | buf[14]);
+        raw->mag[1] = (int16_t)((buf[17] << 8) | buf[16]);
+        raw->mag[2] = (int16_t)((buf[19] << 8) | buf[18]);
+        raw->magStatus = buf[20];
+    }
+    else {
+        raw->mag[0] = raw->mag[1] = raw->mag[2] = 0;
+        raw->magStatus = 0;
+    }
+}
+
+/**
+ * @brief Convert a raw sample to physical units.
+ *
+ * @param mpu Pointer to the MPU9250 handle holding the precomputed scales.
+ * @param raw Raw sample.
+ * @param sample Pointer to the structure receiving g, deg/s and degC.
+ * @return None
+ */
+void mpu9250Convert(const mpu9250_t *mpu, const mpu9250Raw_t *raw, mpu9250Sample_t *sample) {
+    for (int i = 0; i < 3; i++) {
+        sample->accel[i] = raw->accel[i] * mpu->accelScale;
+        sample->gyro[i] = raw->gyro[i] * mpu->gyroScale;
+    }
+    sample->temperature = raw->temperature / MPU9250_TEMP_SENSITIVITY + MPU9250_TEMP_OFFSET;
+
+    /* AK8963 X/Y are swapped and Z is reversed with respect to the accel/gyro axes */
+    sample->magValid = mpu->magEnabled && !(raw->magStatus & AK8963_ST2_HOFL);
+    sample->mag[0] = raw->mag[1] * mpu->magScale[1];
+    sample->mag[1] = raw->mag[0] * mpu->magScale[0];
+    sample->mag[2] = -raw->mag[2] * mpu->magScale[2];
+}
+
+/**
+ * @brief Read accelerometer, temperature and gyroscope in one transaction.
+ *
+ * ACCEL_XOUT_H..GYRO_ZOUT_L are read in a single 14-byte burst, so the
+ * three measurements come from the same sample.
+ *
+ * @param mpu Pointer to an MPU9250 handle initialized with mpu9250Init().
+ * @param raw Pointer to the structure receiving the raw values, not &mpu->raw
+ *            while the interrupt path runs.
+ * @return 0 if successful, 1 if an error occurs during I2C communication.
+ */
+uint8_t mpu9250ReadRaw(mpu9250_t *mpu, mpu9250Raw_t *raw) {
+    uint8_t buf[MPU9250_BURST_SIZE_MAG];
+    uint32_t start = timingCycles();
+
+    if (i2cBusRead(mpu->hi2c, mpu->address, ACCEL_XOUT_H, buf, mpu->burstSize) != 0) {
+        mpu->stats.errors++;
+        return 1;
+    }
+
+    mpu9250Unpack(mpu, buf, raw);
+    if (raw->magStatus & AK8963_ST2_HOFL) {
+        mpu->stats.magOverflows++;
+    }
+    mpu->stats.samples++;
+    mpu->stats.readCycles = timingCycles() - start;
+
+    return 0;
+}
+
+/**
+ * @brief Read and convert one IMU sample.
+ *
+ * The sample is read and converted in a local copy: the interrupt path also
+ * writes mpu->raw, which only receives the result once complete.
+ *
+ * @param mpu Pointer to an MPU9250 handle initialized with mpu9250Init().
+ * @param sample Pointer to the structure receiving the converted values.
+ * @return 0 if successful, 1 if an error occurs during I2C communication.
+ */
+uint8_t mpu9250Read(mpu9250_t *mpu, mpu9250Sample_t *sample) {
+    mpu9250Raw_t raw;
+    uint32_t primask;
+
+    if (mpu9250ReadRaw(mpu, &raw) != 0) {
+        return 1;
+    }
+
+    mpu9250Convert(mpu, &raw, sample);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    mpu->raw = raw;
+    __set_PRIMASK(primask);
+
+    return 0;
+}
+
+/**
+ * @brief Reset the FIFO and restart filling it.
+ */
+static uint8_t mpu9250FifoReset(mpu9250_t *mpu) {
+    if (mpu9250WriteReg(mpu, USER_CTRL, mpu->userCtrl | MPU9250_USER_FIFO_RST) != 0) {
+        return 1;
+    }
+    return mpu9250WriteReg(mpu, USER_CTRL, mpu->userCtrl | MPU9250_USER_FIFO_EN);
+}
+
+/**
+ * @brief Stream accelerometer, temperature and gyroscope samples through the FIFO.
+ *
+ * Each sample is stored as the same 14 bytes as the register burst (21 with
+ * the magnetometer, pushed from EXT_SENS_DATA through SLV0). The FIFO
+ * stops on full instead of overwriting, so frames stay aligned and an
+ * overflow can be told from the byte count.
+ *
+ * @param mpu Pointer to an MPU9250 handle initialized with mpu9250Init().
+ * @param watermark Number of samples below which mpu9250FifoDrain() does nothing.
+ * @return 0 if successful, 1 if the watermark is too high or on I2C error.
+ */
+uint8_t mpu9250FifoEnable(mpu9250_t *mpu, uint16_t watermark) {
+    uint8_t fifoEn = MPU9250_FIFO_EN_ACCEL | MPU9250_FIFO_EN_TEMP | MPU9250_FIFO_EN_GYRO;
+
+    if (watermark == 0 || watermark > MPU9250_FIFO_SIZE / mpu->burstSize) {
+        return 1;
+    }
+
+    if (mpu->magEnabled) {
+        fifoEn |= MPU9250_FIFO_EN_SLV0;
+    }
+    mpu->fifoFrameSize = mpu->burstSize;
+    mpu->fifoWatermark = watermark;
+
+    if (mpu9250WriteReg(mpu, FIFO_EN, 0x00) != 0
+            || mpu9250WriteReg(mpu, CONFIG, MPU9250_CONFIG_FIFO_MODE | (mpu->dlpf & MPU9250_DLPF_MASK)) != 0
+            || mpu9250FifoReset(mpu) != 0
+            || mpu9250WriteReg(mpu, FIFO_EN, fifoEn) != 0) {
+        return 1;
+    }
+
+    mpu->fifoEnabled = 1;
+
+    return 0;
+}
+
+/**
+ * @brief Stop the FIFO stream.
+ *
+ * @param mpu Pointer to the MPU9250 handle.
+ * @return 0 if successful, 1 on I2C error.
+ */
+uint8_t mpu9250FifoDisable(mpu9250_t *mpu) {
+    mpu->fifoEnabled = 0;
+
+    if (mpu9250WriteReg(mpu, FIFO_EN, 0x00) != 0) {
+        return 1;
+    }
+    return mpu9250WriteReg(mpu, USER_CTRL, mpu->userCtrl | MPU9250_USER_FIFO_RST);
+}
+
+/**
+ * @brief Number of whole frames announced by FIFO_COUNTH/L.
+ *
+ * A frame being written when FIFO_COUNT is read is left in the FIFO: only
+ * whole frames are burst, so it completes before the next drain.
+ *
+ * @param mpu Pointer to the MPU9250 handle.
+ * @param buf FIFO_COUNTH, FIFO_COUNTL.
+ * @return Number of whole frames, -1 if the FIFO has overflowed.
+ */
+static int mpu9250FifoFrames(mpu9250_t *mpu, const uint8_t *buf) {
+    uint16_t frame = mpu->fifoFrameSize;
+    uint16_t bytes = ((buf[0] << 8) | buf[1]) & MPU9250_FIFO_COUNT_MASK;
+
+    if (bytes > mpu->stats.fifoMaxLevel) {
+        mpu->stats.fifoMaxLevel = bytes;
+    }
+    if (bytes > (MPU9250_FIFO_SIZE / frame) * frame) {
+        mpu->stats.fifoOverflows++; /**< Partial frame written into a full FIFO */
+        return -1;
+    }
+
+    return bytes / frame;
+}
+
+/**
+ * @brief Flag the samples taken before the gyroscope started up.
+ *
+ * After a wake-on-motion wake-up the gyroscope leaves sleep and its output is
+ * invalid for MPU9250_GYRO_STARTUP_US. Those samples are still delivered, the
+ * accelerometer data being valid, with gyroValid cleared.
+ *
+ * @param mpu Pointer to the MPU9250 handle.
+ * @param n Number of samples in mpu->fifoSamples.
+ * @return None
+ */
+static void mpu9250GyroFlag(mpu9250_t *mpu, uint16_t n) {
+    for (uint16_t i = 0; i < n; i++) {
+        mpu9250FifoSample_t *sample = &mpu->fifoSamples[i];
+
+        if (mpu->gyroSettling && (int32_t)(sample->timestampUs - mpu->gyroValidUs) >= 0) {
+            mpu->gyroSettling = 0;
+        }
+        sample->gyroValid = !mpu->gyroSettling;
+        if (!sample->gyroValid) {
+            mpu->stats.gyroInvalid++;
+        }
+    }
+}
+
+/**
+ * @brief Unpack and timestamp the frames of mpu->fifoBuf, then hand them over.
+ *
+ * @param mpu Pointer to the MPU9250 handle.
+ * @param n Number of frames in mpu->fifoBuf, at least 1.
+ * @param newestUs Timestamp of the last frame.
+ */
+static void mpu9250FifoDeliver(mpu9250_t *mpu, uint16_t n, uint32_t newestUs) {
+    uint16_t frame = mpu->fifoFrameSize;
+
+    for (uint16_t i = 0; i < n; i++) {
+        mpu->fifoSamples[i].timestampUs = newestUs - (uint32_t)(n - 1 - i) * mpu->samplePeriodUs;
+        mpu9250Unpack(mpu, &mpu->fifoBuf[i * frame], &mpu->fifoSamples[i].raw);
+        if (mpu->fifoSamples[i].raw.magStatus & AK8963_ST2_HOFL) {
+            mpu->stats.magOverflows++;
+        }
+    }
+    mpu->raw = mpu->fifoSamples[n - 1].raw;
+
+    mpu->stats.fifoDrains++;
+    mpu->stats.fifoSamples += n;
+    mpu9250GyroFlag(mpu, n);
+    if (mpu->onSamples != NULL) {
+        mpu->onSamples(mpu, mpu->fifoSamples, n);
+    }
+}
+
+/**
+ * @brief Read the FIFO content in one burst once the watermark is reached.
+ *
+ * Two transactions per drain whatever the number of samples: FIFO_COUNT, then
+ * all complete frames from FIFO_R_W. The newest sample is stamped with the
+ * time FIFO_COUNT was read, older ones one sample period apart. A FIFO found
+ * full has dropped samples: it is reset, the overflow is counted and nothing
+ * is delivered for this drain. Samples are passed to mpu->onSamples and stay
+ * in mpu->fifoSamples until the next drain.
+ *
+ * @param mpu Pointer to an MPU9250 handle with the FIFO enabled.
+ * @param count Pointer receiving the number of samples delivered, may be NULL.
+ * @return 0 if successful (including below the watermark), 1 on I2C error or overflow.
+ */
+uint8_t mpu9250FifoDrain(mpu9250_t *mpu, uint16_t *count) {
+    uint32_t start = timingCycles();
+    uint32_t now;
+    int n;
+
+    if (count != NULL) {
+        *count = 0;
+    }
+    if (!mpu->fifoEnabled || mpu->irqEnabled) {
+        return 1; /**< The interrupt path owns the FIFO */
+    }
+
+    if (i2cBusRead(mpu->hi2c, mpu->address, FIFO_COUNTH, mpu->countBuf, 2) != 0) {
+        mpu->stats.errors++;
+        return 1;
+    }
+    now = timingMicros();
+
+    n = mpu9250FifoFrames(mpu, mpu->countBuf);
+    if (n < 0) {
+        mpu9250FifoReset(mpu);
+        return 1;
+    }
+    if (n < mpu->fifoWatermark) {
+        return 0;
+    }
+
+    if (i2cBusRead(mpu->hi2c, mpu->address, FIFO_R_W, mpu->fifoBuf, n * mpu->fifoFrameSize) != 0) {
+        mpu->stats.errors++;
+        mpu9250FifoReset(mpu); /**< Frame alignment is lost */
+        return 1;
+    }
+
+    mpu->stats.fifoDrainCycles = timingCycles() - start;
+    if (count != NULL) {
+        *count = n;
+    }
+    mpu9250FifoDeliver(mpu, n, now);
+
+    return 0;
+}
+
+/**
+ * @brief Queue one step of the interrupt read chain.
+ */
+static uint8_t mpu9250IrqSubmit(mpu9250_t *mpu, mpu9250IrqStage_t stage, uint8_t reg, uint8_t *buf, uint16_t len) {
+    mpu->irqStage = stage;
+    mpu->request.devAddr = mpu->address;
+    mpu->request.reg = reg;
+    mpu->request.write = 0;
+    mpu->request.buf = buf;
+    mpu->request.len = len;
+
+    return i2cQueueSubmit(mpu->hi2c, &mpu->request, I2C_QUEUE_PRIO_HIGH);
+}
+
+/**
+ * @brief Completion of each step of the interrupt read chain, in interrupt context.
+ */
+static void mpu9250IrqDone(i2cRequest_t *req) {
+    mpu9250_t *mpu = (mpu9250_t *)req->context;
+    uint32_t now = timingMicros();
+    uint32_t latency;
+    int n;
+
+    if (req->status != HAL_OK) {
+        mpu->stats.errors++;
+        mpu->irqBusy = 0;
+        return;
+    }
+
+    switch (mpu->irqStage) {
+    case MPU9250_IRQ_BURST:
+        mpu->fifoSamples[0].timestampUs = mpu->edgeUs; /**< Data ready at the edge */
+        mpu9250Unpack(mpu, mpu->fifoBuf, &mpu->fifoSamples[0].raw);
+        if (mpu->fifoSamples[0].raw.magStatus & AK8963_ST2_HOFL) {
+            mpu->stats.magOverflows++;
+        }
+        mpu->raw = mpu->fifoSamples[0].raw;
+        mpu->stats.samples++;
+        n = 1;
+        break;
+
+    case MPU9250_IRQ_COUNT:
+        n = mpu9250FifoFrames(mpu, mpu->countBuf);
+        if (n < 0) {
+            mpu->irqStage = MPU9250_IRQ_RESET;
+            if (i2cQueueSubmit(mpu->hi2c, &mpu->ctrlRequest[0], I2C_QUEUE_PRIO_HIGH) != 0
+                    || i2cQueueSubmit(mpu->hi2c, &mpu->ctrlRequest[1], I2C_QUEUE_PRIO_HIGH) != 0) {
+                mpu->irqBusy = 0;
+            }
+            return;
+        }
+        mpu->edgeUs = now; /**< Newest frame is about as old as the count */
+        if (n == 0 || mpu9250IrqSubmit(mpu, MPU9250_IRQ_FIFO, FIFO_R_W, mpu->fifoBuf, n * mpu->fifoFrameSize) != 0) {
+            mpu->irqBusy = 0;
+        }
+        return;
+
+    case MPU9250_IRQ_FIFO:
+        n = req->len / mpu->fifoFrameSize;
+        mpu->irqPending = 0;
+        break;
+
+    default: /**< MPU9250_IRQ_RESET: second write done */
+        mpu->irqPending = 0;
+        mpu->irqBusy = 0;
+        return;
+    }
+
+    latency = timingCycles() - mpu->edgeCycles;
+    mpu->stats.irqReads++;
+    mpu->stats.irqLatencyCycles = latency;
+    mpu->stats.irqLatencyTotalCycles += latency;
+    if (latency > mpu->stats.irqLatencyMaxCycles) {
+        mpu->stats.irqLatencyMaxCycles = latency;
+    }
+
+    if (mpu->irqStage == MPU9250_IRQ_FIFO) {
+        mpu9250FifoDeliver(mpu, n, mpu->edgeUs);
+    }
+    else {
+        mpu9250GyroFlag(mpu, 1);
+        if (mpu->onSamples != NULL) {
+            mpu->onSamples(mpu, mpu->fifoSamples, 1);
+        }
+    }
+    mpu->irqBusy = 0;
+}
+
+/**
+ * @brief Drive the acquisition from the INT pin instead of polling.
+ *
+ * The chip pulses INT (active high, push-pull, 50 us) on every new sample.
+ * Without FIFO each edge queues the 14-byte burst at I2C_QUEUE_PRIO_HIGH;
+ * with the FIFO on, every fifoWatermark edges queue FIFO_COUNT then the
+ * FIFO burst. The MPU9250 has no FIFO watermark interrupt, hence the edge
+ * count. Reads run by DMA and samples reach mpu->onSamples from the I2C
+ * interrupt, whatever the main loop is doing. Needs MX_GPIO_MpuIntInit().
+ *
+ * @param mpu Pointer to an MPU9250 handle initialized with mpu9250Init().
+ * @param enable 1 to enable, 0 to go back to polling.
+ * @return 0 if successful, 1 on I2C error.
+ */
+uint8_t mpu9250IrqEnable(mpu9250_t *mpu, uint8_t enable) {
+    mpu->irqEnabled = 0;
+    if (mpu9250WriteReg(mpu, INT_ENABLE, 0x00) != 0) {
+        return 1;
+    }
+    if (!enable) {
+        return 0;
+    }
+
+    mpu->request.callback = mpu9250IrqDone;
+    mpu->request.context = mpu;
+    mpu->ctrlBuf[0] = mpu->userCtrl | MPU9250_USER_FIFO_RST;
+    mpu->ctrlBuf[1] = mpu->userCtrl | MPU9250_USER_FIFO_EN;
+    for (int i = 0; i < 2; i++) {
+        mpu->ctrlRequest[i].devAddr = mpu->address;
+        mpu->ctrlRequest[i].reg = USER_CTRL;
+        mpu->ctrlRequest[i].write = 1;
+        mpu->ctrlRequest[i].buf = &mpu->ctrlBuf[i];
+        mpu->ctrlRequest[i].len = 1;
+        mpu->ctrlRequest[i].callback = (i == 1) ? mpu9250IrqDone : NULL;
+        mpu->ctrlRequest[i].context = mpu;
+    }
+    mpu->irqBusy = 0;
+    mpu->irqPending = 0;
+
+    if (mpu9250WriteReg(mpu, INT_PIN_CFG, 0x00) != 0) { /**< Active high, push-pull, 50 us pulse */
+        return 1;
+    }
+    mpu->irqEnabled = 1;
+    if (mpu9250WriteReg(mpu, INT_ENABLE, MPU9250_INT_RAW_RDY_EN) != 0) {
+        mpu->irqEnabled = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief INT pin handler, call it from HAL_GPIO_EXTI_Callback().
+ *
+ * @param mpu Pointer to the MPU9250 handle wired to the pin.
+ * @return None
+ */
+void mpu9250IrqHandler(mpu9250_t *mpu) {
+    uint32_t edge = timingCycles();
+    uint8_t err;
+
+    if (mpu->womState != MPU9250_WOM_OFF) {
+        mpu9250WomWake(mpu); /**< Motion: ignored if already waking */
+        return;
+    }
+    if (!mpu->irqEnabled) {
+        return;
+    }
+    mpu->stats.irqEdges++;
+
+    if (mpu->fifoEnabled && ++mpu->irqPending < mpu->fifoWatermark) {
+        return; /**< Frames accumulate in the FIFO */
+    }
+    if (mpu->irqBusy) {
+        mpu->stats.irqOverruns++;
+        return;
+    }
+
+    mpu->irqBusy = 1;
+    mpu->edgeCycles = edge;
+    mpu->edgeUs = timingMicros();
+    if (mpu->fifoEnabled) {
+        err = mpu9250IrqSubmit(mpu, MPU9250_IRQ_COUNT, FIFO_COUNTH, mpu->countBuf, 2);
+    }
+    else {
+        err = mpu9250IrqSubmit(mpu, MPU9250_IRQ_BURST, ACCEL_XOUT_H, mpu->fifoBuf, mpu->burstSize);
+    }
+    if (err != 0) {
+        mpu->stats.irqOverruns++;
+        mpu->irqBusy = 0;
+    }
+}
+
+/**
+ * @brief Read the gyroscope and accelerometer offset registers.
+ *
+ * @param mpu Pointer to the MPU9250 handle.
+ * @param offsets Pointer to the structure receiving the register values.
+ * @return 0 if successful, 1 on I2C error.
+ */
+uint8_t mpu9250GetOffsets(mpu9250_t *mpu, mpu9250Offsets_t *offsets) {
+    static const uint8_t accelReg[3] = {XA_OFFSET_H, YA_OFFSET_H, ZA_OFFSET_H};
+    uint8_t buf[6];
+
+    if (i2cBusRead(mpu->hi2c, mpu->address, XG_OFFSET_H, buf, 6) != 0) {
+        return 1;
+    }
+    for (int i = 0; i < 3; i++) {
+        offsets->gyro[i] = (int16_t)((buf[2 * i] << 8) | buf[2 * i + 1]);
+    }
+
+    for (int i = 0; i < 3; i++) { /**< The accel pairs are not contiguous */
+        if (i2cBusRead(mpu->hi2c, mpu->address, accelReg[i], buf, 2) != 0) {
+            return 1;
+        }
+        offsets->accel[i] = (int16_t)((buf[0] << 8) | buf[1]) >> 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Write the gyroscope and accelerometer offset registers.
+ *
+ * The chip adds them to every sample, so the bias is gone from the data
+ * registers and the FIFO without any work per sample. They are cleared by
+ * H_RESET (gyro) or reloaded with the factory trim (accel), so they have to
+ * be written again after each mpu9250Init(). Bit 0 of XA/YA/ZA_OFFSET_L is
+ * reserved and kept as read.
+ *
+ * @param mpu Pointer to the MPU9250 handle.
+ * @param offsets Register values to write.
+ * @return 0 if successful, 1 on I2C error.
+ */
+uint8_t mpu9250SetOffsets(mpu9250_t *mpu, const mpu9250Offsets_t *offsets) {
+    static const uint8_t accelReg[3] = {XA_OFFSET_H, YA_OFFSET_H, ZA_OFFSET_H};
+    uint8_t buf[6];
+
+    for (int i = 0; i < 3; i++) {
+        buf[2 * i] = (uint16_t)offsets->gyro[i] >> 8;
+        buf[2 * i + 1] = (uint16_t)offsets->gyro[i] & 0xFF;
+    }
+    if (i2cBusWrite(mpu->hi2c, mpu->address, XG_OFFSET_H, buf, 6) != 0) {
+        return 1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        uint16_t value = (uint16_t)offsets->accel[i] << 1;
+
+        if (i2cBusRead(mpu->hi2c, mpu->address, accelReg[i] + 1, &buf[1], 1) != 0) {
+            return 1;
+        }
+        value |= buf[1] & 0x01;
+        buf[0] = value >> 8;
+        buf[1] = value & 0xFF;
+        if (i2cBusWrite(mpu->hi2c, mpu->address, accelReg[i], buf, 2) != 0) {
+            return 1;
+        }
+    }
+
+    mpu->offsets = *offsets;
+
+    return 0;
+}
+
+/**
+ * @brief Round and saturate an offset register value.
+ */
+static int16_t mpu9250OffsetClamp(float value, int16_t max) {
+    value += value >= 0.0f ? 0.5f : -0.5f;
+    if (value > max) {
+        return max;
+    }
+    if (value < -max - 1) {
+        return -max - 1;
+    }
+    return (int16_t)value;
+}
+
+/**
+ * @brief Measure the biases at rest and cancel them in the offset registers.
+ *
+ * Averages the given number of samples, then corrects the offsets already
+ * in the chip by the residual bias. The board must be still and level, Z up
+ * or down: 1 g is removed from Z, with the sign of the measurement. The gyro
+ * register counts 4 LSB at +-250dps (32.8 LSB/dps) and the accel register
+ * 0.98 mg, whatever the configured full scales. The interrupt path is paused
+ * while sampling.
+ *
+ * @param mpu Pointer to an MPU9250 handle initialized with mpu9250Init().
+ * @param samples Number of samples to average, MPU9250_CALIB_DEFAULT_SAMPLES if unsure.
+ * @return 0 if successful, 1 on I2C error.
+ */
+uint8_t mpu9250Calibrate(mpu9250_t *mpu, uint16_t samples) {
+    mpu9250Offsets_t offsets;
+    mpu9250Raw_t raw;
+    int32_t accelSum[3] = {0};
+    int32_t gyroSum[3] = {0};
+    float gravity = MPU9250_ACCEL_1G_2G >> mpu->accelFs;
+    uint8_t irq = mpu->irqEnabled;
+    uint8_t err;
+
+    if (samples == 0) {
+        return 1;
+    }
+    if (irq && mpu9250IrqEnable(mpu, 0) != 0) {
+        return 1;
+    }
+    while (mpu->irqBusy) {
+        i2cQueueProcess(); /**< Let the last read chain finish */
+    }
+
+    err = mpu9250GetOffsets(mpu, &offsets);
+    for (uint16_t n = 0; err == 0 && n < samples; n++) {
+        timingDelayUs(mpu->samplePeriodUs); /**< One new sample per read */
+        err = mpu9250ReadRaw(mpu, &raw);
+        for (int i = 0; i < 3; i++) {
+            accelSum[i] += raw.accel[i];
+            gyroSum[i] += raw.gyro[i];
+        }
+    }
+
+    if (err == 0) {
+        for (int i = 0; i < 3; i++) {
+            float accelBias = (float)accelSum[i] / samples;
+            float gyroBias = (float)gyroSum[i] / samples;
+
+            if (i == 2) {
+                accelBias -= accelBias > 0.0f ? gravity : -gravity;
+            }
+            offsets.gyro[i] = mpu9250OffsetClamp(offsets.gyro[i] - gyroBias * (1 << mpu->gyroFs) / 4.0f, INT16_MAX);
+            offsets.accel[i] = mpu9250OffsetClamp(offsets.accel[i] - accelBias * (1 << mpu->accelFs) / 16.0f,
+                    MPU9250_ACCEL_OFFSET_MAX);
+        }
+        err = mpu9250SetOffsets(mpu, &offsets);
+    }
+
+    if (irq && mpu9250IrqEnable(mpu, 1) != 0) {
+        err = 1;
+    }
+
+    return err;
+}
+
+/**
+ * @brief Write the offsets stored in flash into the chip.
+ *
+ * Call it after mpu9250Init(): valid data is available at once instead of
+ * after a calibration at every boot.
+ *
+ * @param mpu Pointer to an MPU9250 handle initialized with mpu9250Init().
+ * @return 0 if successful, 1 if no valid record is stored or on I2C error.
+ */
+uint8_t mpu9250LoadOffsets(mpu9250_t *mpu) {
+    mpu9250Offsets_t offsets;
+
+    if (flashStoreLoad(MPU9250_OFFSETS_MAGIC, &offsets, sizeof(offsets)) != 0) {
+        return 1;
+    }
+
+    return mpu9250SetOffsets(mpu, &offsets);
+}
+
+/**
+ * @brief Store the current offsets in flash (erases the store sector).
+ *
+ * @param mpu Pointer to the MPU9250 handle, offsets set by mpu9250Calibrate().
+ * @return 0 if successful, 1 on flash error.
+ */
+uint8_t mpu9250SaveOffsets(mpu9250_t *mpu) {
+    return flashStoreSave(MPU9250_OFFSETS_MAGIC, &mpu->offsets, sizeof(mpu->offsets));
+}
+
+/**
+ * @brief Switch to accelerometer-only wake-on-motion mode.
+ *
+ * Gyroscope, FIFO and I2C master are stopped, the accelerometer is duty
+ * cycled at LP_ACCEL_ODR and the INT pin fires when an axis moves by more
+ * than the threshold between two of its samples. The next edge on the INT pin
+ * runs mpu9250WomWake() from mpu9250IrqHandler(), so the pin must be set up
+ * with MX_GPIO_MpuIntInit(). The MPU9250 has no motion duration counter
+ * (MOT_DUR is an MPU6050 register): debouncing is left to the caller.
+ *
+ * @param mpu Pointer to an MPU9250 handle initialized with mpu9250Init().
+ * @param thresholdMg Motion threshold, 4 mg resolution, up to 1020 mg.
+ * @param lpOdr LP_ACCEL_ODR code, 0.24 Hz * 2^lpOdr: worst-case detection delay.
+ * @return 0 if successful, 1 if already armed, lpOdr is invalid or on I2C error.
+ */
+uint8_t mpu9250WomEnable(mpu9250_t *mpu, uint16_t thresholdMg, uint8_t lpOdr) {
+    uint16_t thr = thresholdMg / MPU9250_WOM_MG_PER_LSB;
+
+    if (lpOdr > MPU9250_LP_ODR_MAX || mpu->womState != MPU9250_WOM_OFF) {
+        return 1;
+    }
+    if (thr == 0) {
+        thr = 1;
+    }
+    else if (thr > 0xFF) {
+        thr = 0xFF;
+    }
+
+    if (mpu9250WriteReg(mpu, INT_ENABLE, 0x00) != 0) {
+        return 1;
+    }
+    while (mpu->irqBusy) {
+        i2cQueueProcess(); /**< Let the last read chain finish */
+    }
+
+    if (mpu9250WriteReg(mpu, USER_CTRL, 0x00) != 0
+            || mpu9250WriteReg(mpu, PWR_MGMT_1, MPU9250_CLKSEL_PLL) != 0
+            || mpu9250WriteReg(mpu, PWR_MGMT_2, MPU9250_DIS_GYRO) != 0
+            || mpu9250WriteReg(mpu, ACCEL_CONFIG2, MPU9250_ACCEL_FCHOICE_B | 1) != 0  /**< 1.13 kHz, no averaging */
+            || mpu9250WriteReg(mpu, MOT_DETECT_CTRL, MPU9250_ACCEL_INTEL_EN | MPU9250_ACCEL_INTEL_MODE) != 0
+            || mpu9250WriteReg(mpu, WOM_THR, (uint8_t)thr) != 0
+            || mpu9250WriteReg(mpu, LP_ACCEL_ODR, lpOdr) != 0) {
+        return 1;
+    }
+
+    mpu->womState = MPU9250_WOM_ARMED; /**< Before the first WOM edge can come */
+    if (mpu9250WriteReg(mpu, INT_ENABLE, MPU9250_INT_WOM_EN) != 0
+            || mpu9250WriteReg(mpu, PWR_MGMT_1, MPU9250_CLKSEL_PLL | MPU9250_PWR_CYCLE) != 0) {
+        mpu->womState = MPU9250_WOM_OFF;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Last wake-up write done: full-rate sampling is back.
+ *
+ * @param req Last request of the wake-up chain.
+ */
+static void mpu9250WomWakeDone(i2cRequest_t *req) {
+    mpu9250_t *mpu = (mpu9250_t *)req->context;
+
+    if (req->status != HAL_OK) {
+        mpu->stats.errors++;
+    }
+    else {
+        mpu->stats.womWakeups++;
+        mpu->stats.wakeCycles = timingCycles() - mpu->wakeEdgeCycles;
+        mpu->gyroValidUs = timingMicros() + MPU9250_GYRO_STARTUP_US;
+        mpu->gyroSettling = 1;
+    }
+    mpu->irqPending = 0;
+    mpu->irqBusy = 0;
+    mpu->womState = MPU9250_WOM_OFF;
+}
+
+/**
+ * @brief Leave wake-on-motion mode and restore full-rate sampling.
+ *
+ * The writes undoing mpu9250WomEnable() are queued at I2C_QUEUE_PRIO_HIGH
+ * without waiting, so this runs from the INT edge and the accelerometer is
+ * back at the profile rate once the 7 single-byte writes are done: about
+ * 0.5 ms at 400 kHz, 2 ms at 100 kHz. The gyroscope then needs
+ * MPU9250_GYRO_STARTUP_US (35 ms) before its output is valid. Samples
+ * timestamped earlier still reach onSamples, so the motion that woke the node
+ * is not lost, but with gyroValid = 0 (counted in stats.gyroInvalid): the
+ * gyro data lags the accelerometer by those 35 ms. mpu->raw and polled reads
+ * carry no flag.
+ * Callable from thread context too, to force a wake-up.
+ *
+ * @param mpu Pointer to the MPU9250 handle.
+ * @return 0 if queued or not armed, 1 if the queue is not running or full.
+ */
+uint8_t mpu9250WomWake(mpu9250_t *mpu) {
+    static const uint8_t regs[MPU9250_WAKE_WRITES] = {
+        PWR_MGMT_1, PWR_MGMT_2, MOT_DETECT_CTRL, ACCEL_CONFIG2, USER_CTRL, USER_CTRL, INT_ENABLE
+    };
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (mpu->womState != MPU9250_WOM_ARMED) {
+        __set_PRIMASK(primask);
+        return 0;
+    }
+    mpu->womState = MPU9250_WOM_WAKING;
+    __set_PRIMASK(primask);
+
+    if (!i2cQueueEnabled(mpu->hi2c)) {
+        mpu->womState = MPU9250_WOM_ARMED;
+        return 1;
+    }
+
+    mpu->wakeEdgeCycles = timingCycles();
+    mpu->wakeBuf[0] = MPU9250_CLKSEL_PLL;
+    mpu->wakeBuf[1] = 0x00; /**< All axes on */
+    mpu->wakeBuf[2] = 0x00;
+    mpu->wakeBuf[3] = mpu9250Profiles[mpu->profile].accelConfig2;
+    mpu->wakeBuf[4] = mpu->userCtrl | MPU9250_USER_FIFO_RST;
+    mpu->wakeBuf[5] = mpu->userCtrl | (mpu->fifoEnabled ? MPU9250_USER_FIFO_EN : 0);
+    mpu->wakeBuf[6] = mpu->irqEnabled ? MPU9250_INT_RAW_RDY_EN : 0x00;
+
+    for (int i = 0; i < MPU9250_WAKE_WRITES; i++) {
+        mpu->wakeRequest[i].devAddr = mpu->address;
+        mpu->wakeRequest[i].reg = regs[i];
+        mpu->wakeRequest[i].write = 1;
+        mpu->wakeRequest[i].buf = &mpu->wakeBuf[i];
+        mpu->wakeRequest[i].len = 1;
+        mpu->wakeRequest[i].callback = (i == MPU9250_WAKE_WRITES - 1) ? mpu9250WomWakeDone : NULL;
+        mpu->wakeRequest[i].context = mpu;
+        if (i2cQueueSubmit(mpu->hi2c, &mpu->wakeRequest[i], I2C_QUEUE_PRIO_HIGH) != 0) {
+            mpu->stats.errors++;
+            mpu->womState = i == 0 ? MPU9250_WOM_ARMED : MPU9250_WOM_OFF; /**< Partly woken: let the caller see it */
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Shell commands ------------------------------------------------------------*/
+
+static const char mpu9250CmdError[] = "MPU9250 error\r\n";
+
+/**
+ * @brief IMU_GET: one converted sample.
+ */
+static uint8_t mpu9250CmdGet(shell_t *shell, int argc, char **argv) {
+    mpu9250Sample_t sample;
+
+    if (mpu9250Read(&hmpu9250, &sample) != 0) {
+        Shell_Print(shell, mpu9250CmdError);
+        return 0;
+    }
+    Shell_Print(shell, "A = %.3f %.3f %.3f g, T = %.1f C\n\r",
+            sample.accel[0], sample.accel[1], sample.accel[2], sample.temperature);
+    Shell_Print(shell, "G = %.2f %.2f %.2f dps, read %lu us\n\r",
+            sample.gyro[0], sample.gyro[1], sample.gyro[2], timingCyclesToUs(hmpu9250.stats.readCycles));
+    if (hmpu9250.magEnabled) {
+        Shell_Print(shell, "M = %.1f %.1f %.1f uT%s, %lu overflows\n\r",
+                sample.mag[0], sample.mag[1], sample.mag[2], sample.magValid ? "" : " (overflow)",
+                hmpu9250.stats.magOverflows);
+    }
+    return 0;
+}
+
+/**
+ * @brief IMU_FIFO [wm|off]: stream through the FIFO, stop it, or show its statistics.
+ */
+static uint8_t mpu9250CmdFifo(shell_t *shell, int argc, char **argv) {
+    uint8_t err = 0;
+
+    if (argc > 1 && strcmp(argv[1], "off") == 0) {
+        err = mpu9250FifoDisable(&hmpu9250);
+    }
+    else if (argc > 1) {
+        err = mpu9250FifoEnable(&hmpu9250, atoi(argv[1]));
+    }
+    if (err != 0) {
+        Shell_Print(shell, mpu9250CmdError);
+        return 0;
+    }
+    Shell_Print(shell, "fifo %s, wm %u, %lu samples in %lu drains, %lu us/drain\n\r",
+            hmpu9250.fifoEnabled ? "on" : "off", hmpu9250.fifoWatermark, hmpu9250.stats.fifoSamples,
+            hmpu9250.stats.fifoDrains, timingCyclesToUs(hmpu9250.stats.fifoDrainCycles));
+    Shell_Print(shell, "overflows %lu, max level %lu B, period %lu us\n\r",
+            hmpu9250.stats.fifoOverflows, hmpu9250.stats.fifoMaxLevel, hmpu9250.samplePeriodUs);
+    return 0;
+}
+
+/**
+ * @brief IMU_IRQ [on|off]: INT pin driven reads, edge to sample latency.
+ */
+static uint8_t mpu9250CmdIrq(shell_t *shell, int argc, char **argv) {
+    mpu9250Stats_t *stats = &hmpu9250.stats;
+
+    if (argc > 1 && mpu9250IrqEnable(&hmpu9250, strcmp(argv[1], "on") == 0) != 0) {
+        Shell_Print(shell, mpu9250CmdError);
+        return 0;
+    }
+    Shell_Print(shell, "irq %s: %lu edges, %lu reads, %lu overruns\n\r",
+            hmpu9250.irqEnabled ? "on" : "off", stats->irqEdges, stats->irqReads, stats->irqOverruns);
+    Shell_Print(shell, "latency: last %lu us, avg %lu us, max %lu us\n\r",
+            timingCyclesToUs(stats->irqLatencyCycles),
+            stats->irqReads ? timingCyclesToUs(stats->irqLatencyTotalCycles / stats->irqReads) : 0,
+            timingCyclesToUs(stats->irqLatencyMaxCycles));
+    return 0;
+}
+
+/**
+ * @brief IMU_PROFILE [p]: rate/bandwidth profile, current settings without argument.
+ */
+static uint8_t mpu9250CmdProfile(shell_t *shell, int argc, char **argv) {
+    if (argc > 1 && mpu9250SetProfile(&hmpu9250, atoi(argv[1])) != 0) {
+        Shell_Print(shell, mpu9250CmdError);
+        return 0;
+    }
+    Shell_Print(shell, "profile %d: dlpf %u, div %u, period %lu us, +-%dg, +-%ddps\n\r",
+            hmpu9250.profile, hmpu9250.dlpf, hmpu9250.sampleRateDiv, hmpu9250.samplePeriodUs,
+            2 << hmpu9250.accelFs, 250 << hmpu9250.gyroFs);
+    return 0;
+}
+
+/**
+ * @brief IMU_FS <g> <dps>: full-scale ranges, e.g. IMU_FS 8 1000.
+ */
+static uint8_t mpu9250CmdFullScale(shell_t *shell, int argc, char **argv) {
+    int accelFs = 0, gyroFs = 0;
+
+    while (accelFs < 4 && (2 << accelFs) != atoi(argv[1])) {
+        accelFs++;
+    }
+    while (gyroFs < 4 && (250 << gyroFs) != atoi(argv[2])) {
+        gyroFs++;
+    }
+    if (mpu9250SetFullScale(&hmpu9250, accelFs, gyroFs) != 0) {
+        Shell_Print(shell, mpu9250CmdError);
+        return 0;
+    }
+    Shell_Print(shell, "+-%dg (%.6f g/LSB), +-%ddps (%.6f dps/LSB)\n\r",
+            2 << hmpu9250.accelFs, hmpu9250.accelScale, 250 << hmpu9250.gyroFs, hmpu9250.gyroScale);
+    return 0;
+}
+
+/**
+ * @brief IMU_CAL [run [n]|load]: calibrate at rest and store, reload from flash, or show the offsets.
+ */
+static uint8_t mpu9250CmdCalibrate(shell_t *shell, int argc, char **argv) {
+    mpu9250Offsets_t *offsets = &hmpu9250.offsets;
+    uint8_t err = 0;
+
+    if (argc > 1 && strcmp(argv[1], "run") == 0) {
+        err = mpu9250Calibrate(&hmpu9250, argc > 2 ? atoi(argv[2]) : MPU9250_CALIB_DEFAULT_SAMPLES);
+        if (err == 0) {
+            err = mpu9250SaveOffsets(&hmpu9250);
+        }
+    }
+    else if (argc > 1 && strcmp(argv[1], "load") == 0) {
+        err = mpu9250LoadOffsets(&hmpu9250);
+    }
+    else if (argc > 1) {
+        return 1;
+    }
+    if (err != 0) {
+        Shell_Print(shell, mpu9250CmdError);
+        return 0;
+    }
+    Shell_Print(shell, "gyro offsets %d %d %d, accel offsets %d %d %d\n\r",
+            offsets->gyro[0], offsets->gyro[1], offsets->gyro[2],
+            offsets->accel[0], offsets->accel[1], offsets->accel[2]);
+    return 0;
+}
+
+SHELL_COMMAND("IMU_GET", mpu9250CmdGet, 0, 0, "", "one accel/gyro/mag sample");
+SHELL_COMMAND("IMU_FIFO", mpu9250CmdFifo, 0, 1, "[watermark|off]", "FIFO streaming and statistics");
+SHELL_COMMAND("IMU_IRQ", mpu9250CmdIrq, 0, 1, "[on|off]", "data ready interrupt and latency");
+SHELL_COMMAND("IMU_PROFILE", mpu9250CmdProfile, 0, 1, "[profile]", "rate/bandwidth profile");
+SHELL_COMMAND("IMU_FS", mpu9250CmdFullScale, 2, 2, "<g> <dps>", "accel and gyro full-scale ranges");
+SHELL_COMMAND("IMU_CAL", mpu9250CmdCalibrate, 0, 2, "[run [samples]|load]", "offset calibration, stored in flash");
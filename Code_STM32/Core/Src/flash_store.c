@@ -0,0 +1,101 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    flash_store.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include <string.h>
+#include "flash_store.h"
+#include "checksum.h"
+
+/**
+ * @brief Copy the stored record if it is valid.
+ *
+ * The record is rejected if the sector is blank, holds another layout
+ * (magic or length differ) or fails the CRC, so a half-written record from
+ * a reset during flashStoreSave() is never used.
+ *
+ * @param magic Expected record magic.
+ * @param data Buffer receiving the payload.
+ * @param len Expected payload length.
+ * @return 0 if a valid record was copied, 1 otherwise (data untouched).
+ */
+uint8_t flashStoreLoad(uint32_t magic, void *data, uint32_t len) {
+    const flashStoreHeader_t *header = (const flashStoreHeader_t *)FLASH_STORE_ADDRESS;
+    const uint8_t *payload = (const uint8_t *)(FLASH_STORE_ADDRESS + sizeof(flashStoreHeader_t));
+
+    if (header->magic != magic || header->length != len || len > FLASH_STORE_MAX_LEN) {
+        return 1;
+    }
+    if (checksumCrc32(payload, len) != header->crc) {
+        return 1;
+    }
+
+    memcpy(data, payload, len);
+
+    return 0;
+}
+
+/**
+ * @brief Erase the sector and write a new record.
+ *
+ * The payload goes first and the header last, so the magic only becomes
+ * valid once everything else is in flash. Erasing the 128K sector takes
+ * one to two seconds during which code fetch from flash (and so every
+ * interrupt) stalls: only call it on user request, never from a loop.
+ *
+ * @param magic Record magic.
+ * @param data Payload to store.
+ * @param len Payload length, at most FLASH_STORE_MAX_LEN.
+ * @return 0 if successful, 1 on erase/program error or if len is too large.
+ */
+uint8_t flashStoreSave(uint32_t magic, const void *data, uint32_t len) {
+    FLASH_EraseInitTypeDef erase = {0};
+    flashStoreHeader_t header;
+    uint32_t sectorError;
+    uint32_t address = FLASH_STORE_ADDRESS + sizeof(flashStoreHeader_t);
+    const uint8_t *bytes = data;
+    uint8_t err = 0;
+
+    if (len > FLASH_STORE_MAX_LEN) {
+        return 1;
+    }
+
+    header.magic = magic;
+    header.length = len;
+    header.crc = checksumCrc32(data, len);
+
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Sector = FLASH_STORE_SECTOR;
+    erase.NbSectors = 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3; /**< 2.7-3.6 V, 32-bit parallelism */
+
+    HAL_FLASH_Unlock();
+    if (HAL_FLASHEx_Erase(&erase, &sectorError) != HAL_OK) {
+        err = 1;
+    }
+
+    for (uint32_t i = 0; err == 0 && i < len; i++) {
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_BYTE, address + i, bytes[i]) != HAL_OK) {
+            err = 1;
+        }
+    }
+    for (uint32_t i = 0; err == 0 && i < sizeof(header) / 4; i++) {
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, FLASH_STORE_ADDRESS + 4 * i, ((uint32_t *)&header)[i]) != HAL_OK) {
+            err = 1;
+        }
+    }
+    HAL_FLASH_Lock();
+
+    return err;
+}
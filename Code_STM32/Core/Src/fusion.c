@@ -0,0 +1,224 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    fusion.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include <math.h>
+#include <stddef.h>
+#include "fusion.h"
+
+fusion_t hfusion;
+
+/**
+ * @brief Reset the orientation to identity and set the filter gain.
+ *
+ * @param fusion Pointer to the fusion handle.
+ * @param gain Madgwick beta, FUSION_DEFAULT_GAIN if unsure.
+ * @return None
+ */
+void fusionInit(fusion_t *fusion, float gain) {
+    fusion->q.w = 1.0f;
+    fusion->q.x = 0.0f;
+    fusion->q.y = 0.0f;
+    fusion->q.z = 0.0f;
+    fusion->gain = gain;
+    fusion->lastUs = 0;
+    fusion->stats = (fusionStats_t){0};
+}
+
+/**
+ * @brief Change the filter gain without touching the orientation.
+ *
+ * A high gain trusts accel/mag more (fast convergence, noisier output), a low
+ * gain trusts the gyroscope more (smooth output, slower drift correction).
+ *
+ * @param fusion Pointer to the fusion handle.
+ * @param gain Madgwick beta, must be >= 0.
+ * @return None
+ */
+void fusionSetGain(fusion_t *fusion, float gain) {
+    fusion->gain = gain < 0.0f ? 0.0f : gain;
+}
+
+/**
+ * @brief Gradient descent step for gravity only (6-axis).
+ *
+ * @param q Current orientation.
+ * @param a Normalized accelerometer.
+ * @param s Receives the unnormalized gradient.
+ */
+static void fusionGradientImu(const fusionQuaternion_t *q, const float a[3], float s[4]) {
+    float q0q0 = q->w * q->w, q1q1 = q->x * q->x, q2q2 = q->y * q->y, q3q3 = q->z * q->z;
+
+    s[0] = 4.0f * q->w * q2q2 + 2.0f * q->y * a[0] + 4.0f * q->w * q1q1 - 2.0f * q->x * a[1];
+    s[1] = 4.0f * q->x * q3q3 - 2.0f * q->z * a[0] + 4.0f * q0q0 * q->x - 2.0f * q->w * a[1] - 4.0f * q->x
+            + 8.0f * q->x * q1q1 + 8.0f * q->x * q2q2 + 4.0f * q->x * a[2];
+    s[2] = 4.0f * q0q0 * q->y + 2.0f * q->w * a[0] + 4.0f * q->y * q3q3 - 2.0f * q->z * a[1] - 4.0f * q->y
+            + 8.0f * q->y * q1q1 + 8.0f * q->y * q2q2 + 4.0f * q->y * a[2];
+    s[3] = 4.0f * q1q1 * q->z - 2.0f * q->x * a[0] + 4.0f * q2q2 * q->z - 2.0f * q->y * a[1];
+}
+
+/**
+ * @brief Gradient descent step for gravity and the earth magnetic field (9-axis).
+ *
+ * The reference field is rebuilt each step from the measured one (horizontal
+ * bx, vertical bz), so the magnetic inclination does not need to be known
+ * and the magnetometer only corrects heading.
+ *
+ * @param q Current orientation.
+ * @param a Normalized accelerometer.
+ * @param m Normalized magnetometer.
+ * @param s Receives the unnormalized gradient.
+ */
+static void fusionGradientMarg(const fusionQuaternion_t *q, const float a[3], const float m[3], float s[4]) {
+    float q0 = q->w, q1 = q->x, q2 = q->y, q3 = q->z;
+    float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+    float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+    float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+    float hx, hy, bx2, bz2, bx4, bz4;
+    float fAx, fAy, fAz, fMx, fMy, fMz;
+
+    /* Earth frame field, then its horizontal/vertical reference */
+    hx = m[0] * (q0q0 + q1q1 - q2q2 - q3q3) + 2.0f * m[1] * (q1q2 - q0q3) + 2.0f * m[2] * (q0q2 + q1q3);
+    hy = 2.0f * m[0] * (q0q3 + q1q2) + m[1] * (q0q0 - q1q1 + q2q2 - q3q3) + 2.0f * m[2] * (q2q3 - q0q1);
+    bx2 = sqrtf(hx * hx + hy * hy);
+    bz2 = 2.0f * m[0] * (q1q3 - q0q2) + 2.0f * m[1] * (q0q1 + q2q3) + m[2] * (q0q0 - q1q1 - q2q2 + q3q3);
+    bx4 = 2.0f * bx2;
+    bz4 = 2.0f * bz2;
+
+    /* Objective function: predicted minus measured, gravity then field */
+    fAx = 2.0f * q1q3 - 2.0f * q0q2 - a[0];
+    fAy = 2.0f * q0q1 + 2.0f * q2q3 - a[1];
+    fAz = 1.0f - 2.0f * q1q1 - 2.0f * q2q2 - a[2];
+    fMx = bx2 * (0.5f - q2q2 - q3q3) + bz2 * (q1q3 - q0q2) - m[0];
+    fMy = bx2 * (q1q2 - q0q3) + bz2 * (q0q1 + q2q3) - m[1];
+    fMz = bx2 * (q0q2 + q1q3) + bz2 * (0.5f - q1q1 - q2q2) - m[2];
+
+    /* Jacobian transpose times the objective function */
+    s[0] = -2.0f * q2 * fAx + 2.0f * q1 * fAy
+            - bz2 * q2 * fMx + (-bx2 * q3 + bz2 * q1) * fMy + bx2 * q2 * fMz;
+    s[1] = 2.0f * q3 * fAx + 2.0f * q0 * fAy - 4.0f * q1 * fAz
+            + bz2 * q3 * fMx + (bx2 * q2 + bz2 * q0) * fMy + (bx2 * q3 - bz4 * q1) * fMz;
+    s[2] = -2.0f * q0 * fAx + 2.0f * q3 * fAy - 4.0f * q2 * fAz
+            + (-bx4 * q2 - bz2 * q0) * fMx + (bx2 * q1 + bz2 * q3) * fMy + (bx2 * q0 - bz4 * q2) * fMz;
+    s[3] = 2.0f * q1 * fAx + 2.0f * q2 * fAy
+            + (-bx4 * q3 + bz2 * q1) * fMx + (-bx2 * q0 + bz2 * q2) * fMy + bx2 * q1 * fMz;
+}
+
+/**
+ * @brief Run one Madgwick filter step.
+ *
+ * Integrates the gyroscope rate and pulls the result toward the orientation
+ * given by the accelerometer (and the magnetometer when mag is not NULL) by
+ * gain * dt. A zero accelerometer or magnetometer vector is skipped. Without
+ * gyro (NULL, e.g. during its start-up) the orientation is only pulled by the
+ * correction, so fast rotations lag until the gyroscope is back. Cycle
+ * statistics are left to the caller, which owns the cycle counter.
+ *
+ * @param fusion Pointer to the fusion handle.
+ * @param gyro Angular rate in deg/s, or NULL.
+ * @param accel Acceleration in any unit (normalized here).
+ * @param mag Magnetic field in any unit, already in the accel/gyro frame, or NULL.
+ * @param dt Time since the previous sample in seconds.
+ * @return None
+ */
+void fusionUpdate(fusion_t *fusion, const float gyro[3], const float accel[3], const float *mag, float dt) {
+    fusionQuaternion_t *q = &fusion->q;
+    float gx = 0.0f, gy = 0.0f, gz = 0.0f;
+    float a[3], m[3], s[4];
+    float qDot[4];
+    float norm;
+
+    if (gyro != NULL) {
+        gx = gyro[0] * FUSION_DEG_TO_RAD;
+        gy = gyro[1] * FUSION_DEG_TO_RAD;
+        gz = gyro[2] * FUSION_DEG_TO_RAD;
+    }
+    else {
+        fusion->stats.updatesNoGyro++;
+    }
+
+    /* Rate of change from the gyroscope: qDot = 0.5 * q x (0, g) */
+    qDot[0] = 0.5f * (-q->x * gx - q->y * gy - q->z * gz);
+    qDot[1] = 0.5f * (q->w * gx + q->y * gz - q->z * gy);
+    qDot[2] = 0.5f * (q->w * gy - q->x * gz + q->z * gx);
+    qDot[3] = 0.5f * (q->w * gz + q->x * gy - q->y * gx);
+
+    norm = accel[0] * accel[0] + accel[1] * accel[1] + accel[2] * accel[2];
+    if (norm > 0.0f) {
+        norm = 1.0f / sqrtf(norm);
+        a[0] = accel[0] * norm;
+        a[1] = accel[1] * norm;
+        a[2] = accel[2] * norm;
+
+        norm = mag != NULL ? mag[0] * mag[0] + mag[1] * mag[1] + mag[2] * mag[2] : 0.0f;
+        if (norm > 0.0f) {
+            norm = 1.0f / sqrtf(norm);
+            m[0] = mag[0] * norm;
+            m[1] = mag[1] * norm;
+            m[2] = mag[2] * norm;
+            fusionGradientMarg(q, a, m, s);
+        }
+        else {
+            fusionGradientImu(q, a, s);
+            fusion->stats.updatesNoMag++;
+        }
+
+        norm = s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3];
+        if (norm > 0.0f) {
+            norm = fusion->gain / sqrtf(norm);
+            qDot[0] -= norm * s[0];
+            qDot[1] -= norm * s[1];
+            qDot[2] -= norm * s[2];
+            qDot[3] -= norm * s[3];
+        }
+    }
+
+    q->w += qDot[0] * dt;
+    q->x += qDot[1] * dt;
+    q->y += qDot[2] * dt;
+    q->z += qDot[3] * dt;
+
+    norm = 1.0f / sqrtf(q->w * q->w + q->x * q->x + q->y * q->y + q->z * q->z);
+    q->w *= norm;
+    q->x *= norm;
+    q->y *= norm;
+    q->z *= norm;
+
+    fusion->stats.updates++;
+}
+
+/**
+ * @brief Convert a quaternion to roll, pitch and yaw.
+ *
+ * Kept out of fusionUpdate() so the trigonometry is only paid when the angles
+ * are actually read.
+ *
+ * @param q Orientation to convert.
+ * @param euler Receives the angles in degrees (pitch clamped to +-90).
+ * @return None
+ */
+void fusionGetEuler(const fusionQuaternion_t *q, fusionEuler_t *euler) {
+    float sinPitch = 2.0f * (q->w * q->y - q->z * q->x);
+
+    if (sinPitch > 1.0f) {
+        sinPitch = 1.0f;
+    }
+    else if (sinPitch < -1.0f) {
+        sinPitch = -1.0f;
+    }
+
+    euler->roll = atan2f(2.0f * (q->w * q->x + q->y * q->z), 1.0f - 2.0f * (q->x * q->x + q->y * q->y)) * FUSION_RAD_TO_DEG;
+    euler->pitch = asinf(sinPitch) * FUSION_RAD_TO_DEG;
+    euler->yaw = atan2f(2.0f * (q->w * q->z + q->x * q->y), 1.0f - 2.0f * (q->y * q->y + q->z * q->z)) * FUSION_RAD_TO_DEG;
+}
@@ -69,5 +69,21 @@ void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 2 */
+/** Configure the MPU9250 INT pin (PA8, Arduino D7) as rising-edge EXTI */
+void MX_GPIO_MpuIntInit(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+
+  GPIO_InitStruct.Pin = MPU_INT_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+  HAL_GPIO_Init(MPU_INT_GPIO_Port, &GPIO_InitStruct);
+
+  /* Same level as the I2C/DMA interrupts that carry on the read */
+  HAL_NVIC_SetPriority(MPU_INT_EXTI_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(MPU_INT_EXTI_IRQn);
+}
 
 /* USER CODE END 2 */
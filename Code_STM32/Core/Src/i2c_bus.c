@@ -0,0 +1,439 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    i2c_bus.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include <stdlib.h>
+#include <string.h>
+#include "i2c.h"
+#include "i2c_bus.h"
+#include "i2c_queue.h"
+#include "i2c_trace.h"
+#include "timing.h"
+#include "shell.h"
+
+/**
+ * @brief Pins of a bus, driven as GPIO during the recovery sequence.
+ */
+typedef struct i2cBusPins_s {
+    I2C_TypeDef *instance;
+    GPIO_TypeDef *port;
+    uint16_t scl;
+    uint16_t sda;
+} i2cBusPins_t;
+
+static const i2cBusPins_t i2cBusPins[] = {
+    {I2C1, GPIOB, GPIO_PIN_6, GPIO_PIN_7}, /**< PB6 SCL, PB7 SDA, see MX_I2C1_Init() */
+};
+
+#define I2C_BUS_HALF_PERIOD_US  5 /**< 100 kHz recovery clock */
+
+static uint32_t i2cBusTimeoutMs = I2C_BUS_TIMEOUT_MS;
+static i2cBusStats_t i2cBusStats[I2C_BUS_COUNT];
+static i2cBusStats_t i2cBusStatsUnknown; /**< Sink for handles outside I2C1..I2C3 */
+
+/**
+ * @brief Set the timeout applied to every blocking transaction.
+ *
+ * The HAL checks it on each flag wait, so a transaction is bounded by a small
+ * multiple of this value plus the recovery sequence.
+ *
+ * @param timeoutMs Timeout in milliseconds (at least 1).
+ * @return None
+ */
+void i2cBusSetTimeout(uint32_t timeoutMs) {
+    i2cBusTimeoutMs = (timeoutMs == 0) ? 1 : timeoutMs;
+}
+
+/**
+ * @brief Get the timeout applied to every blocking transaction.
+ *
+ * @return Timeout in milliseconds.
+ */
+uint32_t i2cBusGetTimeout(void) {
+    return i2cBusTimeoutMs;
+}
+
+/**
+ * @brief Timeout of one transaction, scaled with its length.
+ *
+ * The HAL timeout covers the whole transfer, so long bursts (FIFO drains)
+ * get their wire time on top of the configured margin.
+ *
+ * @param hi2c I2C bus.
+ * @param len Payload bytes.
+ * @return Timeout in milliseconds.
+ */
+uint32_t i2cBusTransferTimeout(I2C_HandleTypeDef *hi2c, uint16_t len) {
+    /* 9 clocks per byte, plus address, register and repeated start */
+    uint32_t wireMs = ((uint32_t)(len + 3) * 9U * 1000U) / hi2c->Init.ClockSpeed;
+
+    return i2cBusTimeoutMs + wireMs;
+}
+
+/**
+ * @brief Get the error counters of a bus.
+ *
+ * @param hi2c I2C bus.
+ * @return Pointer to the counters of this bus.
+ */
+i2cBusStats_t* i2cBusGetStats(I2C_HandleTypeDef *hi2c) {
+    if (hi2c->Instance == I2C1) {
+        return &i2cBusStats[0];
+    }
+    if (hi2c->Instance == I2C2) {
+        return &i2cBusStats[1];
+    }
+    if (hi2c->Instance == I2C3) {
+        return &i2cBusStats[2];
+    }
+    return &i2cBusStatsUnknown;
+}
+
+/**
+ * @brief Record the duration of a transaction and keep the worst case.
+ */
+static void i2cBusRecordDuration(i2cBusStats_t *stats, uint32_t start) {
+    uint32_t cycles = timingCycles() - start;
+
+    if (cycles > stats->worstCycles) {
+        stats->worstCycles = cycles;
+    }
+}
+
+/**
+ * @brief Blocking HAL read, the queue being disabled or paused.
+ */
+static uint8_t i2cBusReadDirect(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, uint8_t *buf, uint16_t len) {
+    i2cBusStats_t *stats = i2cBusGetStats(hi2c);
+    uint32_t start = timingCycles();
+    HAL_StatusTypeDef status;
+
+    stats->transfers++;
+    status = HAL_I2C_Mem_Read(hi2c, devAddr, reg, I2C_MEMADD_SIZE_8BIT, buf, len, i2cBusTransferTimeout(hi2c, len));
+    i2cTraceRecord(hi2c, devAddr, reg, len, 0, start, status);
+    if (status != HAL_OK) {
+        i2cBusHandleError(hi2c, status);
+    }
+    i2cBusRecordDuration(stats, start);
+
+    return (status == HAL_OK) ? 0 : 1;
+}
+
+/**
+ * @brief Read consecutive registers of a device.
+ *
+ * @param hi2c I2C bus.
+ * @param devAddr 8-bit device address (7-bit address shifted left).
+ * @param reg First register address.
+ * @param buf Destination buffer.
+ * @param len Number of bytes to read.
+ * @return 0 if successful, 1 on error (the bus has then been recovered).
+ *
+ * @note When the transaction queue of the bus is enabled, the read is queued
+ *       at I2C_QUEUE_PRIO_NORMAL and this function waits for its completion.
+ */
+uint8_t i2cBusRead(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, uint8_t *buf, uint16_t len) {
+    if (i2cQueueEnabled(hi2c)) {
+        i2cRequest_t req = {.devAddr = devAddr, .reg = reg, .write = 0, .buf = buf, .len = len};
+        return i2cQueueTransfer(hi2c, &req, I2C_QUEUE_PRIO_NORMAL);
+    }
+
+    return i2cBusReadDirect(hi2c, devAddr, reg, buf, len);
+}
+
+/**
+ * @brief Write consecutive registers of a device.
+ *
+ * @param hi2c I2C bus.
+ * @param devAddr 8-bit device address (7-bit address shifted left).
+ * @param reg First register address.
+ * @param buf Source buffer.
+ * @param len Number of bytes to write.
+ * @return 0 if successful, 1 on error (the bus has then been recovered).
+ *
+ * @note Queued like i2cBusRead() when the transaction queue is enabled.
+ */
+uint8_t i2cBusWrite(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, const uint8_t *buf, uint16_t len) {
+    i2cBusStats_t *stats = i2cBusGetStats(hi2c);
+    uint32_t start = timingCycles();
+    HAL_StatusTypeDef status;
+
+    if (i2cQueueEnabled(hi2c)) {
+        i2cRequest_t req = {.devAddr = devAddr, .reg = reg, .write = 1, .buf = (uint8_t *)buf, .len = len};
+        return i2cQueueTransfer(hi2c, &req, I2C_QUEUE_PRIO_NORMAL);
+    }
+
+    stats->transfers++;
+    status = HAL_I2C_Mem_Write(hi2c, devAddr, reg, I2C_MEMADD_SIZE_8BIT, (uint8_t *)buf, len,
+                               i2cBusTransferTimeout(hi2c, len));
+    i2cTraceRecord(hi2c, devAddr, reg, len, 1, start, status);
+    if (status != HAL_OK) {
+        i2cBusHandleError(hi2c, status);
+    }
+    i2cBusRecordDuration(stats, start);
+
+    return (status == HAL_OK) ? 0 : 1;
+}
+
+/**
+ * @brief Check whether a device acknowledges its address.
+ *
+ * A missing device is not a bus fault: no recovery is run and no error is counted.
+ * Meant for probing at start-up, before queued traffic runs on the bus.
+ *
+ * @param hi2c I2C bus.
+ * @param devAddr 8-bit device address (7-bit address shifted left).
+ * @return 1 if the device answers, 0 otherwise.
+ */
+uint8_t i2cBusIsReady(I2C_HandleTypeDef *hi2c, uint16_t devAddr) {
+    return (HAL_I2C_IsDeviceReady(hi2c, devAddr, 2, i2cBusTimeoutMs) == HAL_OK) ? 1 : 0;
+}
+
+/**
+ * @brief Count a failed transaction and recover the bus.
+ *
+ * Also called by the drivers when a non-blocking transfer fails or times out.
+ * Must not be called from interrupt context.
+ *
+ * @param hi2c I2C bus.
+ * @param status HAL status of the failed transaction.
+ * @return None
+ */
+void i2cBusHandleError(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status) {
+    i2cBusStats_t *stats = i2cBusGetStats(hi2c);
+
+    stats->errors++;
+    if (status == HAL_TIMEOUT) {
+        stats->timeouts++;
+    }
+    else if (status == HAL_BUSY) {
+        stats->busy++;
+    }
+    if (hi2c->ErrorCode & HAL_I2C_ERROR_AF) {
+        stats->nacks++;
+    }
+
+    i2cBusRecover(hi2c);
+}
+
+/**
+ * @brief Release a stuck bus and re-initialize the peripheral.
+ *
+ * A slave interrupted in the middle of a read keeps SDA low until it has
+ * shifted its byte out. The sequence clocks SCL nine times with the pins in
+ * GPIO open-drain mode, generates a STOP condition, then resets the peripheral
+ * and re-initializes it with its current settings (hi2c->Init, as set by
+ * MX_I2C1_Init() or a later speed change).
+ *
+ * @param hi2c I2C bus.
+ * @return 0 if SDA is released and the peripheral is re-initialized, 1 otherwise.
+ */
+uint8_t i2cBusRecover(I2C_HandleTypeDef *hi2c) {
+    i2cBusStats_t *stats = i2cBusGetStats(hi2c);
+    const i2cBusPins_t *pins = NULL;
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    uint8_t result = 0;
+
+    stats->recoveries++;
+
+    for (unsigned i = 0; i < sizeof(i2cBusPins) / sizeof(i2cBusPins[0]); i++) {
+        if (i2cBusPins[i].instance == hi2c->Instance) {
+            pins = &i2cBusPins[i];
+        }
+    }
+
+    /* Software reset clears a BUSY flag latched by a glitch */
+    hi2c->Instance->CR1 |= I2C_CR1_SWRST;
+    hi2c->Instance->CR1 &= ~I2C_CR1_SWRST;
+    HAL_I2C_DeInit(hi2c); /**< Releases the pins from the alternate function */
+
+    if (pins != NULL) {
+        HAL_GPIO_WritePin(pins->port, pins->scl | pins->sda, GPIO_PIN_SET);
+        GPIO_InitStruct.Pin = pins->scl | pins->sda;
+        GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+        GPIO_InitStruct.Pull = GPIO_NOPULL;
+        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+        HAL_GPIO_Init(pins->port, &GPIO_InitStruct);
+        timingDelayUs(I2C_BUS_HALF_PERIOD_US);
+
+        for (int i = 0; i < I2C_BUS_RECOVERY_PULSES; i++) {
+            HAL_GPIO_WritePin(pins->port, pins->scl, GPIO_PIN_RESET);
+            timingDelayUs(I2C_BUS_HALF_PERIOD_US);
+            HAL_GPIO_WritePin(pins->port, pins->scl, GPIO_PIN_SET);
+            timingDelayUs(I2C_BUS_HALF_PERIOD_US);
+        }
+
+        /* STOP: SDA rises while SCL is high */
+        HAL_GPIO_WritePin(pins->port, pins->scl, GPIO_PIN_RESET);
+        HAL_GPIO_WritePin(pins->port, pins->sda, GPIO_PIN_RESET);
+        timingDelayUs(I2C_BUS_HALF_PERIOD_US);
+        HAL_GPIO_WritePin(pins->port, pins->scl, GPIO_PIN_SET);
+        timingDelayUs(I2C_BUS_HALF_PERIOD_US);
+        HAL_GPIO_WritePin(pins->port, pins->sda, GPIO_PIN_SET);
+        timingDelayUs(I2C_BUS_HALF_PERIOD_US);
+
+        if (HAL_GPIO_ReadPin(pins->port, pins->sda) != GPIO_PIN_SET) {
+            result = 1; /**< A slave still holds SDA */
+        }
+        HAL_GPIO_DeInit(pins->port, pins->scl | pins->sda);
+    }
+
+    if (HAL_I2C_Init(hi2c) != HAL_OK) { /**< MspInit restores the alternate function and IRQs */
+        result = 1;
+    }
+    if (result != 0) {
+        stats->recoveryFailures++;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Change the SCL frequency of a bus at runtime.
+ *
+ * Both the BMP280 and the MPU9250 support fast mode, so 400 kHz quadruples
+ * the bandwidth available to the sensors. The duty cycle only applies in
+ * fast mode; I2C_DUTYCYCLE_16_9 needs APB1 to be a multiple of 10 MHz to
+ * reach exactly 400 kHz. The transaction queue is paused around the
+ * re-initialization, so a transfer started from an interrupt (IMU data
+ * ready, wake-on-motion) waits for the new speed instead of being killed.
+ *
+ * @param hi2c I2C bus.
+ * @param speed SCL frequency in Hz, up to I2C_BUS_SPEED_FAST.
+ * @param duty I2C_DUTYCYCLE_2 or I2C_DUTYCYCLE_16_9.
+ * @return 0 if successful, 1 if the parameters are invalid or the bus is busy.
+ */
+uint8_t i2cBusSetSpeed(I2C_HandleTypeDef *hi2c, uint32_t speed, uint32_t duty) {
+    uint8_t result;
+
+    if (speed == 0 || speed > I2C_BUS_SPEED_FAST) {
+        return 1;
+    }
+    if (duty != I2C_DUTYCYCLE_2 && duty != I2C_DUTYCYCLE_16_9) {
+        return 1;
+    }
+
+    i2cQueuePause(hi2c);
+    if (HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY) {
+        i2cQueueResume(hi2c);
+        return 1; /**< Never reconfigure under a transfer in flight */
+    }
+    hi2c->Init.ClockSpeed = speed;
+    hi2c->Init.DutyCycle = duty;
+    result = (HAL_I2C_Init(hi2c) != HAL_OK) ? 1 : 0; /**< Recomputes CCR and TRISE from PCLK1 */
+    i2cQueueResume(hi2c);
+
+    return result;
+}
+
+/**
+ * @brief Measure throughput and latency of register reads at the current speed.
+ *
+ * The device register is read loops times; each transaction is timed with
+ * the cycle counter. The transaction queue is paused meanwhile and the reads
+ * are blocking HAL calls, so queued traffic (IMU) does not skew the figures;
+ * it resumes afterwards, the IMU FIFO covering the gap.
+ *
+ * @param hi2c I2C bus.
+ * @param devAddr 8-bit device address (7-bit address shifted left).
+ * @param reg First register address.
+ * @param len Bytes per transaction, up to I2C_BUS_BENCH_MAX_LEN.
+ * @param loops Number of transactions.
+ * @param bench Pointer to the structure receiving the results.
+ * @return 0 if at least one transaction succeeded, 1 otherwise.
+ */
+uint8_t i2cBusBenchmark(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, uint16_t len,
+                        uint32_t loops, i2cBusBench_t *bench) {
+    uint8_t buf[I2C_BUS_BENCH_MAX_LEN];
+    uint32_t totalCycles = 0;
+    uint32_t maxCycles = 0;
+
+    if (len == 0 || len > I2C_BUS_BENCH_MAX_LEN) {
+        return 1;
+    }
+
+    bench->speed = hi2c->Init.ClockSpeed;
+    bench->duty = hi2c->Init.DutyCycle;
+    bench->transactions = 0;
+    bench->errors = 0;
+
+    i2cQueuePause(hi2c);
+    for (uint32_t i = 0; i < loops; i++) {
+        uint32_t start = timingCycles();
+        uint8_t err = i2cBusReadDirect(hi2c, devAddr, reg, buf, len);
+        uint32_t cycles = timingCycles() - start;
+
+        if (err != 0) {
+            bench->errors++;
+            continue;
+        }
+        bench->transactions++;
+        totalCycles += cycles;
+        if (cycles > maxCycles) {
+            maxCycles = cycles;
+        }
+    }
+    i2cQueueResume(hi2c);
+
+    if (bench->transactions == 0) {
+        bench->bytesPerSec = 0;
+        bench->latencyAvgUs = 0;
+        bench->latencyMaxUs = 0;
+        return 1;
+    }
+
+    bench->latencyAvgUs = timingCyclesToUs(totalCycles / bench->transactions);
+    bench->latencyMaxUs = timingCyclesToUs(maxCycles);
+    bench->bytesPerSec = (uint32_t)(((uint64_t)bench->transactions * len * SystemCoreClock) / totalCycles);
+
+    return 0;
+}
+
+/* Shell commands ------------------------------------------------------------*/
+
+/**
+ * @brief I2C_STAT [timeout_ms]: error counters of I2C1, optionally set the transaction timeout.
+ */
+static uint8_t i2cBusCmdStat(shell_t *shell, int argc, char **argv) {
+    i2cBusStats_t *stats = i2cBusGetStats(&hi2c1);
+
+    if (argc > 1) {
+        i2cBusSetTimeout(atoi(argv[1]));
+    }
+    Shell_Print(shell, "i2c1: %lu xfers, %lu errors, timeout %lu ms\n\r",
+            stats->transfers, stats->errors, i2cBusGetTimeout());
+    Shell_Print(shell, "timeouts %lu, nacks %lu, busy %lu\n\r",
+            stats->timeouts, stats->nacks, stats->busy);
+    Shell_Print(shell, "recoveries %lu (%lu failed), worst %lu us\n\r",
+            stats->recoveries, stats->recoveryFailures, timingCyclesToUs(stats->worstCycles));
+    return 0;
+}
+
+/**
+ * @brief I2C_SPEED <hz> [2|16_9]: clock of I2C1, refused while a shell acquisition is in flight.
+ */
+static uint8_t i2cBusCmdSpeed(shell_t *shell, int argc, char **argv) {
+    uint32_t duty = (argc > 2 && strcmp(argv[2], "16_9") == 0) ? I2C_DUTYCYCLE_16_9 : I2C_DUTYCYCLE_2;
+
+    if (Shell_Busy() || i2cBusSetSpeed(&hi2c1, atoi(argv[1]), duty) != 0) {
+        return 1;
+    }
+    Shell_Print(shell, "i2c1: %lu Hz, duty %s\n\r", hi2c1.Init.ClockSpeed,
+            (hi2c1.Init.DutyCycle == I2C_DUTYCYCLE_16_9) ? "16/9" : "2");
+    return 0;
+}
+
+SHELL_COMMAND("I2C_STAT", i2cBusCmdStat, 0, 1, "[timeout_ms]", "I2C1 error counters and timeout");
+SHELL_COMMAND("I2C_SPEED", i2cBusCmdSpeed, 1, 2, "<hz> [2|16_9]", "I2C1 clock and fast mode duty cycle");
@@ -0,0 +1,518 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    i2c_queue.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include <string.h>
+#include "i2c_queue.h"
+#include "i2c_bus.h"
+#include "i2c_trace.h"
+#include "timing.h"
+#include "shell.h"
+
+/**
+ * @brief Transaction engine of one bus.
+ *
+ * One ring of request pointers per priority. The completion interrupt starts
+ * the next request of the highest non-empty priority, so transfers run back
+ * to back without the main loop. Errors are only flagged from interrupt
+ * context; the bus recovery runs in i2cQueueProcess().
+ */
+typedef struct i2cQueue_s {
+    I2C_HandleTypeDef *hi2c;                                /**< NULL while the queue is disabled */
+    i2cRequest_t *ring[I2C_QUEUE_PRIO_COUNT][I2C_QUEUE_DEPTH];
+    uint8_t head[I2C_QUEUE_PRIO_COUNT];
+    uint8_t count[I2C_QUEUE_PRIO_COUNT];
+    i2cRequest_t * volatile active;                         /**< Transfer in flight */
+    i2cQueuePrio_t activePrio;
+    uint32_t activeTick;                                    /**< HAL tick at start of the active transfer */
+    uint32_t activeTimeout;                                 /**< Timeout of the active transfer, ms */
+    uint32_t activeCycles;                                  /**< Cycle counter at start of the active transfer */
+    volatile HAL_StatusTypeDef fault;                       /**< Recovery pending, HAL_OK when none */
+    uint8_t paused;                                         /**< i2cQueuePause() depth, requests only queue meanwhile */
+    i2cQueueStats_t stats[I2C_QUEUE_PRIO_COUNT];
+} i2cQueue_t;
+
+static i2cQueue_t i2cQueues[I2C_BUS_COUNT];
+
+/**
+ * @brief Mask the interrupts that touch the queues: I2C, I2C DMA and IMU EXTI.
+ *
+ * BASEPRI rather than PRIMASK: SysTick and the UARTs, at a higher priority,
+ * keep running, and so do the HAL timeouts.
+ *
+ * @return The previous BASEPRI, for i2cQueueUnlock().
+ */
+static uint32_t i2cQueueLock(void) {
+    uint32_t basepri = __get_BASEPRI();
+
+    __set_BASEPRI_MAX(I2C_QUEUE_IRQ_PRIORITY << (8U - __NVIC_PRIO_BITS));
+    return basepri;
+}
+
+static void i2cQueueUnlock(uint32_t basepri) {
+    __set_BASEPRI(basepri);
+}
+
+/**
+ * @brief Queue of a bus.
+ *
+ * @return The queue, NULL if i2cQueueInit() was not called for this bus.
+ */
+static i2cQueue_t *i2cQueueGet(I2C_HandleTypeDef *hi2c) {
+    for (int i = 0; i < I2C_BUS_COUNT; i++) {
+        if (i2cQueues[i].hi2c == hi2c) {
+            return &i2cQueues[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Finish a transfer claimed by the caller: statistics, callback.
+ *
+ * Runs unlocked, from thread context or from the I2C/DMA interrupts.
+ */
+static void i2cQueueFinish(i2cQueue_t *q, i2cRequest_t *req, i2cQueuePrio_t prio, HAL_StatusTypeDef status) {
+    i2cBusStats_t *bus = i2cBusGetStats(q->hi2c);
+    uint32_t cycles = timingCycles() - q->activeCycles;
+
+    if (cycles > bus->worstCycles) {
+        bus->worstCycles = cycles;
+    }
+    i2cTraceRecord(q->hi2c, req->devAddr, req->reg, req->len, req->write, q->activeCycles, status);
+    if (status == HAL_OK) {
+        q->stats[prio].completed++;
+    }
+    else {
+        q->stats[prio].errors++;
+    }
+
+    req->status = status;
+    if (req->callback != NULL) {
+        req->callback(req);
+    }
+}
+
+/**
+ * @brief Start the next queued request if the bus is free.
+ *
+ * The request is claimed as active under the lock, then started with the
+ * lock released: in this HAL version the address phase of a DMA memory
+ * transfer is polled, about three byte times in the caller, with HAL_GetTick()
+ * timeouts. A submission from an interrupt meanwhile sees the bus active and
+ * only queues.
+ */
+static void i2cQueueStartNext(i2cQueue_t *q) {
+    for (;;) {
+        i2cRequest_t *req = NULL;
+        i2cQueuePrio_t prio;
+        HAL_StatusTypeDef status;
+        uint32_t basepri, wait;
+
+        basepri = i2cQueueLock();
+        if (q->active != NULL || q->fault != HAL_OK || q->paused != 0) {
+            i2cQueueUnlock(basepri);
+            return;
+        }
+        for (prio = I2C_QUEUE_PRIO_HIGH; prio < I2C_QUEUE_PRIO_COUNT; prio++) {
+            if (q->count[prio] != 0) {
+                req = q->ring[prio][q->head[prio]];
+                q->head[prio] = (q->head[prio] + 1) % I2C_QUEUE_DEPTH;
+                q->count[prio]--;
+                q->stats[prio].depth = q->count[prio];
+                break;
+            }
+        }
+        if (req == NULL) {
+            i2cQueueUnlock(basepri);
+            return;
+        }
+
+        q->activeTick = HAL_GetTick();
+        q->activeTimeout = i2cBusTransferTimeout(q->hi2c, req->len);
+        q->activeCycles = timingCycles();
+        wait = q->activeCycles - req->submitCycles;
+        q->stats[prio].waitTotalCycles += wait;
+        if (wait > q->stats[prio].waitMaxCycles) {
+            q->stats[prio].waitMaxCycles = wait;
+        }
+        i2cBusGetStats(q->hi2c)->transfers++;
+        q->active = req;
+        q->activePrio = prio;
+        i2cQueueUnlock(basepri);
+
+        if (req->write) {
+            status = HAL_I2C_Mem_Write_DMA(q->hi2c, req->devAddr, req->reg, I2C_MEMADD_SIZE_8BIT, req->buf, req->len);
+        }
+        else {
+            status = HAL_I2C_Mem_Read_DMA(q->hi2c, req->devAddr, req->reg, I2C_MEMADD_SIZE_8BIT, req->buf, req->len);
+        }
+        if (status == HAL_OK) {
+            return;
+        }
+
+        basepri = i2cQueueLock();
+        if (q->active != req) {
+            req = NULL;                                     /**< Already timed out or cancelled */
+        }
+        else {
+            q->active = NULL;
+            q->fault = status; /**< The peripheral refused the transfer: recover before going on */
+        }
+        i2cQueueUnlock(basepri);
+        if (req != NULL) {
+            i2cQueueFinish(q, req, prio, status);
+        }
+    }
+}
+
+/**
+ * @brief Completion of the active transfer, from the HAL callbacks.
+ */
+static void i2cQueueComplete(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status) {
+    i2cQueue_t *q = i2cQueueGet(hi2c);
+    i2cRequest_t *req;
+
+    if (q == NULL || q->active == NULL) {
+        return;
+    }
+
+    req = q->active;
+    q->active = NULL;
+    if (status != HAL_OK) {
+        q->fault = status;
+    }
+    i2cQueueFinish(q, req, q->activePrio, status);
+    i2cQueueStartNext(q);
+}
+
+/**
+ * @brief Enable the transaction queue of a bus.
+ *
+ * From then on, every i2cBusRead()/i2cBusWrite() on this bus goes through
+ * the queue at I2C_QUEUE_PRIO_NORMAL.
+ *
+ * @param hi2c I2C bus, with its DMA streams linked (see HAL_I2C_MspInit()).
+ * @return 0 if successful, 1 if no queue is left.
+ */
+uint8_t i2cQueueInit(I2C_HandleTypeDef *hi2c) {
+    if (i2cQueueGet(hi2c) != NULL) {
+        return 0;
+    }
+    for (int i = 0; i < I2C_BUS_COUNT; i++) {
+        if (i2cQueues[i].hi2c == NULL) {
+            memset(&i2cQueues[i], 0, sizeof(i2cQueue_t));
+            i2cQueues[i].fault = HAL_OK;
+            i2cQueues[i].hi2c = hi2c;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Check whether the transaction queue of a bus is enabled.
+ *
+ * @param hi2c I2C bus.
+ * @return 1 if enabled, 0 otherwise.
+ */
+uint8_t i2cQueueEnabled(I2C_HandleTypeDef *hi2c) {
+    return (i2cQueueGet(hi2c) != NULL) ? 1 : 0;
+}
+
+/**
+ * @brief Queue a register transfer.
+ *
+ * The request starts immediately if the bus is idle, otherwise after the
+ * requests of higher priority and those of the same priority queued before
+ * it. A transfer already in flight is never interrupted. Callable from
+ * interrupt context, e.g. from a data-ready interrupt.
+ *
+ * @param hi2c I2C bus.
+ * @param req Request filled by the caller; it must stay valid until completion.
+ * @param prio Priority of the request.
+ * @return 0 if queued, 1 if the queue is disabled or full.
+ */
+uint8_t i2cQueueSubmit(I2C_HandleTypeDef *hi2c, i2cRequest_t *req, i2cQueuePrio_t prio) {
+    i2cQueue_t *q = i2cQueueGet(hi2c);
+    uint32_t basepri;
+
+    if (q == NULL || prio >= I2C_QUEUE_PRIO_COUNT) {
+        return 1;
+    }
+
+    basepri = i2cQueueLock();
+    if (q->count[prio] == I2C_QUEUE_DEPTH) {
+        q->stats[prio].rejected++;
+        i2cQueueUnlock(basepri);
+        return 1;
+    }
+
+    req->status = HAL_BUSY;
+    req->submitCycles = timingCycles();
+    q->ring[prio][(q->head[prio] + q->count[prio]) % I2C_QUEUE_DEPTH] = req;
+    q->count[prio]++;
+    q->stats[prio].submitted++;
+    q->stats[prio].depth = q->count[prio];
+    if (q->count[prio] > q->stats[prio].maxDepth) {
+        q->stats[prio].maxDepth = q->count[prio];
+    }
+    i2cQueueUnlock(basepri);
+
+    i2cQueueStartNext(q);
+
+    return 0;
+}
+
+/**
+ * @brief Withdraw a request.
+ *
+ * A queued request is removed without callback. A request in flight is
+ * detached with status HAL_TIMEOUT and the bus is recovered by the next
+ * i2cQueueProcess(), since the F4 HAL cannot abort a memory transfer.
+ *
+ * @param hi2c I2C bus.
+ * @param req Request to withdraw.
+ * @return 0 if withdrawn, 1 if it had already completed.
+ */
+uint8_t i2cQueueCancel(I2C_HandleTypeDef *hi2c, i2cRequest_t *req) {
+    i2cQueue_t *q = i2cQueueGet(hi2c);
+    uint8_t result = 1;
+    uint32_t basepri;
+
+    if (q == NULL) {
+        return 1;
+    }
+
+    basepri = i2cQueueLock();
+    if (q->active == req) {
+        q->active = NULL;
+        q->fault = HAL_TIMEOUT;
+        q->stats[q->activePrio].errors++;
+        i2cTraceRecord(hi2c, req->devAddr, req->reg, req->len, req->write, q->activeCycles, HAL_TIMEOUT);
+        req->status = HAL_TIMEOUT;
+        result = 0;
+    }
+    for (int prio = 0; prio < I2C_QUEUE_PRIO_COUNT && result != 0; prio++) {
+        for (int i = 0; i < q->count[prio]; i++) {
+            if (q->ring[prio][(q->head[prio] + i) % I2C_QUEUE_DEPTH] != req) {
+                continue;
+            }
+            for (; i < q->count[prio] - 1; i++) { /**< Close the gap, order is kept */
+                q->ring[prio][(q->head[prio] + i) % I2C_QUEUE_DEPTH] =
+                        q->ring[prio][(q->head[prio] + i + 1) % I2C_QUEUE_DEPTH];
+            }
+            q->count[prio]--;
+            q->stats[prio].depth = q->count[prio];
+            req->status = HAL_ERROR;
+            result = 0;
+            break;
+        }
+    }
+    i2cQueueUnlock(basepri);
+
+    return result;
+}
+
+/**
+ * @brief Stop starting requests and wait for the transfer in flight.
+ *
+ * Submissions, from interrupts too, keep being queued and start at
+ * i2cQueueResume(). Meanwhile the caller owns the idle peripheral, e.g. to
+ * re-initialize it or to run blocking HAL transfers. The wait is bounded by
+ * the timeout of the active transfer. Calls nest; thread context only.
+ *
+ * @param hi2c I2C bus.
+ * @return None
+ */
+void i2cQueuePause(I2C_HandleTypeDef *hi2c) {
+    i2cQueue_t *q = i2cQueueGet(hi2c);
+    uint32_t basepri;
+
+    if (q == NULL) {
+        return;
+    }
+
+    basepri = i2cQueueLock();
+    q->paused++;
+    i2cQueueUnlock(basepri);
+
+    while (q->active != NULL) {
+        i2cQueueProcess(); /**< Timeout and recovery of the last transfer */
+    }
+}
+
+/**
+ * @brief Undo i2cQueuePause() and start the requests queued meanwhile.
+ *
+ * @param hi2c I2C bus.
+ * @return None
+ */
+void i2cQueueResume(I2C_HandleTypeDef *hi2c) {
+    i2cQueue_t *q = i2cQueueGet(hi2c);
+    uint32_t basepri;
+
+    if (q == NULL) {
+        return;
+    }
+
+    basepri = i2cQueueLock();
+    if (q->paused != 0) {
+        q->paused--;
+    }
+    i2cQueueUnlock(basepri);
+
+    i2cQueueStartNext(q);
+}
+
+/**
+ * @brief Run a request and wait for its completion.
+ *
+ * Used by i2cBusRead()/i2cBusWrite() so that blocking driver calls share the
+ * bus with the queued traffic. Must not be called from interrupt context.
+ *
+ * @param hi2c I2C bus.
+ * @param req Request filled by the caller; its callback is ignored.
+ * @param prio Priority of the request.
+ * @return 0 if successful, 1 on error or timeout.
+ */
+uint8_t i2cQueueTransfer(I2C_HandleTypeDef *hi2c, i2cRequest_t *req, i2cQueuePrio_t prio) {
+    /* Every transfer ahead is bounded by the bus timeout: this is a safety net only */
+    uint32_t deadline = i2cBusGetTimeout() * (I2C_QUEUE_DEPTH * I2C_QUEUE_PRIO_COUNT + 1);
+    uint32_t start = HAL_GetTick();
+
+    req->callback = NULL;
+    if (i2cQueueSubmit(hi2c, req, prio) != 0) {
+        return 1;
+    }
+
+    while (req->status == HAL_BUSY) {
+        i2cQueueProcess();
+        if ((HAL_GetTick() - start) > deadline) {
+            i2cQueueCancel(hi2c, req);
+            i2cQueueProcess();
+        }
+    }
+
+    return (req->status == HAL_OK) ? 0 : 1;
+}
+
+/**
+ * @brief Enforce the bus timeout and recover from errors, from the main loop.
+ *
+ * A transfer running longer than i2cBusTransferTimeout() is completed with
+ * HAL_TIMEOUT. After an error the bus goes through the recovery sequence of
+ * i2cBusHandleError(), then the queue resumes.
+ *
+ * @return None
+ */
+void i2cQueueProcess(void) {
+    for (int i = 0; i < I2C_BUS_COUNT; i++) {
+        i2cQueue_t *q = &i2cQueues[i];
+        i2cRequest_t *req = NULL;
+        i2cQueuePrio_t prio = I2C_QUEUE_PRIO_HIGH;
+        HAL_StatusTypeDef fault;
+        uint32_t basepri;
+
+        if (q->hi2c == NULL) {
+            continue;
+        }
+
+        basepri = i2cQueueLock();
+        if (q->active != NULL && (HAL_GetTick() - q->activeTick) > q->activeTimeout) {
+            req = q->active;
+            prio = q->activePrio;
+            q->active = NULL;
+            q->fault = HAL_TIMEOUT;
+        }
+        fault = q->fault;
+        i2cQueueUnlock(basepri);
+        if (req != NULL) {
+            i2cQueueFinish(q, req, prio, HAL_TIMEOUT); /**< Callback outside the lock */
+        }
+
+        if (fault != HAL_OK) {
+            i2cBusHandleError(q->hi2c, fault); /**< Also aborts the DMA streams */
+            q->fault = HAL_OK;
+        }
+
+        i2cQueueStartNext(q);
+    }
+}
+
+/**
+ * @brief Contention statistics of one priority.
+ *
+ * @param hi2c I2C bus.
+ * @param prio Priority.
+ * @return Pointer to the statistics, NULL if the queue is disabled.
+ */
+const i2cQueueStats_t* i2cQueueGetStats(I2C_HandleTypeDef *hi2c, i2cQueuePrio_t prio) {
+    i2cQueue_t *q = i2cQueueGet(hi2c);
+
+    if (q == NULL || prio >= I2C_QUEUE_PRIO_COUNT) {
+        return NULL;
+    }
+    return &q->stats[prio];
+}
+
+/**
+ * @brief I2C memory read complete callback, runs in interrupt context.
+ */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    i2cQueueComplete(hi2c, HAL_OK);
+}
+
+/**
+ * @brief I2C memory write complete callback, runs in interrupt context.
+ */
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    i2cQueueComplete(hi2c, HAL_OK);
+}
+
+/**
+ * @brief I2C error callback, runs in interrupt context.
+ */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+    i2cQueueComplete(hi2c, HAL_ERROR);
+}
+
+/* Shell commands ------------------------------------------------------------*/
+
+/**
+ * @brief I2C_QUEUE: depth, completions and wait time per priority of every queue.
+ */
+static uint8_t i2cQueueCmd(shell_t *shell, int argc, char **argv) {
+    static const char *names[I2C_QUEUE_PRIO_COUNT] = {"high", "normal", "low"};
+
+    for (int i = 0; i < I2C_BUS_COUNT; i++) {
+        if (i2cQueues[i].hi2c == NULL) {
+            continue;
+        }
+        for (int prio = 0; prio < I2C_QUEUE_PRIO_COUNT; prio++) {
+            const i2cQueueStats_t *stats = &i2cQueues[i].stats[prio];
+            uint32_t done = stats->completed + stats->errors;
+
+            Shell_Print(shell, "%s: depth %lu/%lu, %lu done, %lu err, %lu full, ",
+                    names[prio], stats->depth, stats->maxDepth, stats->completed, stats->errors, stats->rejected);
+            Shell_Print(shell, "wait avg %lu us, max %lu us\n\r",
+                    done ? timingCyclesToUs(stats->waitTotalCycles / done) : 0,
+                    timingCyclesToUs(stats->waitMaxCycles));
+        }
+    }
+    return 0;
+}
+
+SHELL_COMMAND("I2C_QUEUE", i2cQueueCmd, 0, 0, "", "I2C transaction queue statistics");
@@ -0,0 +1,270 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    i2c_trace.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include <stdlib.h>
+#include <string.h>
+#include "i2c_trace.h"
+#include "timing.h"
+#include "shell.h"
+
+volatile uint8_t i2cTraceEnabled = 1;
+
+static i2cTraceEntry_t i2cTraceRing[I2C_TRACE_DEPTH];
+static volatile uint32_t i2cTraceHead;  /**< Total number of transfers recorded */
+static uint32_t i2cTraceSorted[I2C_TRACE_DEPTH]; /**< Scratch for the percentiles */
+static uint32_t i2cTraceDumpAge;                 /**< Entries of the I2C_TRACE dump still to print */
+static uint8_t i2cTraceDumpEnabled;              /**< Recording state restored after the dump */
+
+/**
+ * @brief Record one completed transfer.
+ *
+ * Called by i2c_bus.c and i2c_queue.c for every transfer, from thread or
+ * interrupt context. Costs a few dozen cycles; the oldest entry is
+ * overwritten once the ring is full.
+ *
+ * @param hi2c I2C bus.
+ * @param devAddr 8-bit device address.
+ * @param reg First register.
+ * @param len Payload bytes.
+ * @param write 0 read, 1 write.
+ * @param startCycles timingCycles() at the start of the transfer.
+ * @param status Result of the transfer.
+ * @return None
+ */
+void i2cTraceRecord(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, uint16_t len, uint8_t write,
+                    uint32_t startCycles, HAL_StatusTypeDef status) {
+    uint32_t cycles = timingCycles() - startCycles;
+    uint32_t now = timingMicros();
+    i2cTraceEntry_t *entry;
+    uint32_t primask;
+
+    if (!i2cTraceEnabled) {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    entry = &i2cTraceRing[i2cTraceHead % I2C_TRACE_DEPTH];
+    i2cTraceHead++;
+    __set_PRIMASK(primask);
+
+    entry->timestampUs = now - timingCyclesToUs(cycles);
+    entry->durationCycles = cycles;
+    entry->devAddr = devAddr;
+    entry->len = len;
+    entry->reg = reg;
+    entry->write = write;
+    entry->status = (uint8_t)status;
+    entry->bus = (hi2c->Instance == I2C1) ? 1 : (hi2c->Instance == I2C2) ? 2 : 3;
+}
+
+/**
+ * @brief Empty the ring.
+ *
+ * @return None
+ */
+void i2cTraceClear(void) {
+    i2cTraceHead = 0;
+}
+
+/**
+ * @brief Number of transfers available in the ring.
+ *
+ * @return At most I2C_TRACE_DEPTH.
+ */
+uint32_t i2cTraceCount(void) {
+    return (i2cTraceHead < I2C_TRACE_DEPTH) ? i2cTraceHead : I2C_TRACE_DEPTH;
+}
+
+/**
+ * @brief Copy one transfer out of the ring.
+ *
+ * @param age 0 for the most recent transfer, i2cTraceCount() - 1 for the oldest.
+ * @param entry Pointer to the structure receiving the copy.
+ * @return 0 if successful, 1 if age is out of range.
+ */
+uint8_t i2cTraceGet(uint32_t age, i2cTraceEntry_t *entry) {
+    uint32_t primask;
+
+    if (age >= i2cTraceCount()) {
+        return 1;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    *entry = i2cTraceRing[(i2cTraceHead - 1 - age) % I2C_TRACE_DEPTH];
+    __set_PRIMASK(primask);
+
+    return 0;
+}
+
+/**
+ * @brief Value at a given per-mille rank of a sorted array.
+ */
+static uint32_t i2cTracePercentile(const uint32_t *sorted, uint32_t n, uint32_t permille) {
+    uint32_t idx = (n * permille + 999U) / 1000U; /**< Nearest-rank method */
+
+    return sorted[(idx == 0) ? 0 : idx - 1];
+}
+
+/**
+ * @brief Aggregate the transfers currently in the ring.
+ *
+ * Bus utilization is the sum of transfer durations over the time from the
+ * first start to the last completion. Percentiles use the nearest-rank
+ * method on each device's durations. Recording is paused meanwhile.
+ *
+ * @param report Pointer to the structure receiving the results.
+ * @return None
+ */
+void i2cTraceAnalyze(i2cTraceReport_t *report) {
+    uint8_t enabled = i2cTraceEnabled;
+    uint32_t n = i2cTraceCount();
+    uint32_t busyUs = 0;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    i2cTraceEntry_t entry;
+
+    i2cTraceEnabled = 0;
+    memset(report, 0, sizeof(i2cTraceReport_t));
+    report->entries = n;
+
+    for (uint32_t age = 0; age < n; age++) {
+        i2cTraceGet(age, &entry);
+        uint32_t us = timingCyclesToUs(entry.durationCycles);
+        uint32_t end = entry.timestampUs + us;
+        i2cTraceDevice_t *dev = NULL;
+
+        busyUs += us;
+        if (age == 0 || (int32_t)(end - last) > 0) {
+            last = end;
+        }
+        if (age == 0 || (int32_t)(entry.timestampUs - first) < 0) {
+            first = entry.timestampUs;
+        }
+
+        for (uint32_t d = 0; d < report->deviceCount; d++) {
+            if (report->devices[d].devAddr == entry.devAddr) {
+                dev = &report->devices[d];
+            }
+        }
+        if (dev == NULL) {
+            if (report->deviceCount == I2C_TRACE_MAX_DEVICES) {
+                continue;
+            }
+            dev = &report->devices[report->deviceCount++];
+            dev->devAddr = entry.devAddr;
+        }
+        dev->count++;
+        dev->totalUs += us;
+        if (entry.status != HAL_OK) {
+            dev->errors++;
+        }
+    }
+
+    report->windowUs = last - first;
+    if (report->windowUs != 0) {
+        report->utilizationPermille = (uint32_t)(((uint64_t)busyUs * 1000U) / report->windowUs);
+    }
+
+    for (uint32_t d = 0; d < report->deviceCount; d++) {
+        i2cTraceDevice_t *dev = &report->devices[d];
+        uint32_t m = 0;
+
+        for (uint32_t age = 0; age < n; age++) {
+            i2cTraceGet(age, &entry);
+            if (entry.devAddr != dev->devAddr) {
+                continue;
+            }
+            uint32_t us = timingCyclesToUs(entry.durationCycles);
+            uint32_t j = m++;
+            while (j > 0 && i2cTraceSorted[j - 1] > us) { /**< Insertion sort, n <= I2C_TRACE_DEPTH */
+                i2cTraceSorted[j] = i2cTraceSorted[j - 1];
+                j--;
+            }
+            i2cTraceSorted[j] = us;
+        }
+        dev->p50Us = i2cTracePercentile(i2cTraceSorted, m, 500);
+        dev->p99Us = i2cTracePercentile(i2cTraceSorted, m, 990);
+    }
+
+    i2cTraceEnabled = enabled;
+}
+
+/* Shell commands ------------------------------------------------------------*/
+
+/**
+ * @brief Deferred part of I2C_TRACE: entries, oldest first, then the statistics.
+ *
+ * A full ring is about 6 KB of text, more than the UART transmit ring: lines
+ * are printed while they fit and the rest waits for the DMA, without
+ * blocking the main loop. Recording stays paused until the dump is done so
+ * that the ages do not shift under it.
+ */
+static uint8_t i2cTraceCmdPoll(shell_t *shell, void *context) {
+    static i2cTraceReport_t report;
+    i2cTraceEntry_t entry;
+
+    while (i2cTraceDumpAge > 0) {
+        if (Shell_Room(shell) < I2C_TRACE_LINE_MAX) {
+            return 1;
+        }
+        i2cTraceDumpAge--;
+        if (i2cTraceGet(i2cTraceDumpAge, &entry) != 0) {
+            continue;
+        }
+        Shell_Print(shell, "%10lu i2c%d 0x%02X %c 0x%02X x%u %lu us st%d\n\r",
+                entry.timestampUs, entry.bus, entry.devAddr >> 1, entry.write ? 'W' : 'R', entry.reg,
+                entry.len, timingCyclesToUs(entry.durationCycles), entry.status);
+    }
+    if (Shell_Room(shell) < (I2C_TRACE_MAX_DEVICES + 1) * I2C_TRACE_LINE_MAX) {
+        return 1;
+    }
+
+    i2cTraceAnalyze(&report);
+    i2cTraceEnabled = i2cTraceDumpEnabled;
+    Shell_Print(shell, "%lu xfers in %lu us, bus busy %lu.%lu %%\n\r", report.entries,
+            report.windowUs, report.utilizationPermille / 10, report.utilizationPermille % 10);
+    for (uint32_t d = 0; d < report.deviceCount; d++) {
+        Shell_Print(shell, "0x%02X: %u xfers, %u err, %lu us, p50 %lu us, p99 %lu us\n\r",
+                report.devices[d].devAddr >> 1, report.devices[d].count, report.devices[d].errors,
+                report.devices[d].totalUs, report.devices[d].p50Us, report.devices[d].p99Us);
+    }
+    return 0;
+}
+
+/**
+ * @brief I2C_TRACE [n|clear]: last n transfers then per-device statistics, or empty the ring.
+ */
+static uint8_t i2cTraceCmd(shell_t *shell, int argc, char **argv) {
+    uint32_t n = (argc > 1) ? atoi(argv[1]) : 16;
+
+    if (argc > 1 && strcmp(argv[1], "clear") == 0) {
+        i2cTraceClear();
+        n = 0;
+    }
+    if (n > i2cTraceCount()) {
+        n = i2cTraceCount(); /**< Older entries do not exist, do not spin over them */
+    }
+
+    i2cTraceDumpAge = n;
+    i2cTraceDumpEnabled = i2cTraceEnabled;
+    i2cTraceEnabled = 0;
+    Shell_Defer(shell, i2cTraceCmdPoll, NULL);
+    return 0;
+}
+
+SHELL_COMMAND("I2C_TRACE", i2cTraceCmd, 0, 1, "[n|clear]", "last I2C transfers and per-device latency");
@@ -24,6 +24,7 @@
 #include "../../Inc/log/console.h"
 
 #include "../../Inc/usart.h"
+#include "../../Inc/uart_tx.h"
 
 #define _LOGBUF_SIZE_       255
 
@@ -43,12 +44,20 @@ static inline void _addtobuf(char c){
 		_logbuf_i += 1;
 	}
 }
-static inline void _sendbuf(void){
-	uint16_t i=0;
-	for(i=0; i<_logbuf_i; i++){
-		HAL_UART_Transmit(&huart2,&(_logbuf[i]),1,10);
-		HAL_UART_Transmit(&huart1,&(_logbuf[i]),1,10);
+/* USART2 is shared with the shell: queue in its DMA ring (uart_tx.c) rather than
+   transmit directly, which fails with HAL_BUSY while a chunk is in flight.
+   Blocking only before Shell_Init() has started the ring (boot messages). */
+static void _write(const char *data, uint16_t len){
+	if(uartTxGetStats(&huart2) == NULL){
+		HAL_UART_Transmit(&huart2, (uint8_t *)data, len, 10 * len);
+	}
+	else{
+		uartTxWrite(&huart2, (const uint8_t *)data, len);
 	}
+}
+
+static inline void _sendbuf(void){
+	_write(_logbuf, _logbuf_i); /* one write: a full ring drops the whole line, not its end */
 	_log_route = 0;
 }
 
@@ -56,8 +65,7 @@ static inline void _sendbuf(void){
 static inline void _putchar(char c)
 {
 	if(_log_route == 0) {
-		HAL_UART_Transmit(&huart2,&c,1,10);
-		HAL_UART_Transmit(&huart1,&c,1,10);
+		_write(&c, 1);
 	}
 	else{
 		_addtobuf(c);
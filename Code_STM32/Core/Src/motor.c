@@ -1,6 +1,8 @@
 #include "main.h"
+#include <stdlib.h>
 #include "can.h"
 #include "motor.h"
+#include "shell.h"
 #include "log/logger.h"
 #include "BMP280/drv_BMP280.h"
 
@@ -73,8 +75,8 @@ void motorSetPosition(uint8_t positionAngle, uint8_t positionSign) {
  * the sign to 1. The resulting position is then passed to the motorSetPosition
  * function for further processing and transmission.
  *
- * @note This function assumes the CAN hardware (hcan1) is already initialized,
- *       and a BMP280 sensor is available for temperature readings.
+ * @note This function assumes the CAN hardware (hcan1) is already initialized.
+ *       It does nothing if no BMP280 sensor was probed.
  *
  * @return None
  *
@@ -82,10 +84,35 @@ void motorSetPosition(uint8_t positionAngle, uint8_t positionSign) {
  */
 void motorSetPositionDenpendingTemperature(void) {
     uint8_t positionTemperatureRate; /**< Calculated position based on temperature */
-    bmp280Struct_t bmp;               /**< BMP280 sensor structure for temperature readings */
 
-    bmp280GetTemperature(&bmp); /**< Obtain current temperature from BMP280 sensor */
-    positionTemperatureRate = bmp.temperature % 180; /**< Calculate position based on temperature */
+    if (bmp280Count == 0) {
+        printf("motorSetPositionDenpendingTemperature error: no BMP280");  /**< hbmp280[0] has no bus */
+        return;
+    }
+    bmp280GetTemperature(&hbmp280[0]); /**< Obtain current temperature from the first BMP280 sensor */
+    positionTemperatureRate = hbmp280[0].temperature % 180; /**< Calculate position based on temperature */
     
     motorSetPosition(positionTemperatureRate, 1); /**< Set motor position using calculated values */
 }
+
+/**
+ * @brief GO_TO <angle>: send a target position to the motor.
+ */
+static uint8_t motorCmdGoTo(shell_t *shell, int argc, char **argv) {
+    uint8_t positionAngle = atoi(argv[1]);
+
+    motorSetPosition(positionAngle, 1);
+    Shell_Print(shell, "Go to %d°\n\r", positionAngle);
+    return 0;
+}
+
+/**
+ * @brief GET_K / GET_A: reserved for the temperature coefficient and the motor angle.
+ */
+static uint8_t motorCmdReserved(shell_t *shell, int argc, char **argv) {
+    return 0;
+}
+
+SHELL_COMMAND("GO_TO", motorCmdGoTo, 1, 1, "<angle>", "motor target position");
+SHELL_COMMAND("GET_K", motorCmdReserved, 0, 0, "", "temperature coefficient (not implemented)");
+SHELL_COMMAND("GET_A", motorCmdReserved, 0, 0, "", "motor angle (not implemented)");
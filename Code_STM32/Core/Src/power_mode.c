@@ -0,0 +1,183 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    power_mode.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include <math.h>
+#include <stdlib.h>
+#include "power_mode.h"
+#include "shell.h"
+#include "timing.h"
+#include "BMP280/drv_BMP280.h"
+
+static mpu9250_t *powerModeImu;
+static powerModeState_t powerModeCurrent;
+static volatile uint32_t powerModeLastMotionMs;    /**< Written from the IMU interrupt path */
+static uint32_t powerModeEnteredMs;
+static uint32_t powerModeEntries[POWER_MODE_COUNT];
+static uint32_t powerModeTimeMs[POWER_MODE_COUNT];
+static uint32_t powerModeFailures;
+static uint32_t powerModeIdleTimeoutMs;
+static uint16_t powerModeThresholdMg;
+static bmp280Profile_t powerModeBmpProfile[BMP280_MAX_DEVICES]; /**< Restored when active again */
+
+/**
+ * @brief Start in active mode with the given idle timeout and threshold.
+ *
+ * Can be called again at any time to change the settings, the IMU is woken
+ * up first if it was idle.
+ *
+ * @param mpu IMU that gates the sampling.
+ * @param idleTimeoutMs Time without motion before going idle, 0 to stay active.
+ * @param thresholdMg Acceleration change counted as motion.
+ * @return None
+ */
+void powerModeInit(mpu9250_t *mpu, uint32_t idleTimeoutMs, uint16_t thresholdMg) {
+    if (powerModeImu != NULL && powerModeCurrent == POWER_MODE_IDLE) {
+        mpu9250WomWake(powerModeImu); /**< powerModeProcess() finishes the transition */
+    }
+    else {
+        powerModeCurrent = POWER_MODE_ACTIVE;
+        powerModeEnteredMs = HAL_GetTick();
+        powerModeEntries[POWER_MODE_ACTIVE]++;
+    }
+
+    powerModeImu = mpu;
+    powerModeIdleTimeoutMs = idleTimeoutMs;
+    powerModeThresholdMg = thresholdMg;
+    powerModeLastMotionMs = HAL_GetTick();
+}
+
+/**
+ * @brief Look for motion in an active-mode sample.
+ *
+ * Called for every IMU sample (interrupt context is fine). Motion is an
+ * acceleration norm away from 1 g by more than the threshold, or a rotation
+ * faster than POWER_MODE_GYRO_THRESHOLD_DPS. Relies on calibrated offsets.
+ *
+ * @param sample Converted IMU sample.
+ * @return None
+ */
+void powerModeSample(const mpu9250Sample_t *sample) {
+    float accel = sample->accel[0] * sample->accel[0] + sample->accel[1] * sample->accel[1]
+            + sample->accel[2] * sample->accel[2];
+    float gyro = sample->gyro[0] * sample->gyro[0] + sample->gyro[1] * sample->gyro[1]
+            + sample->gyro[2] * sample->gyro[2];
+
+    if (fabsf(sqrtf(accel) - 1.0f) * 1000.0f > powerModeThresholdMg
+            || gyro > POWER_MODE_GYRO_THRESHOLD_DPS * POWER_MODE_GYRO_THRESHOLD_DPS) {
+        powerModeLastMotionMs = HAL_GetTick();
+    }
+}
+
+/**
+ * @brief Account the time of the current mode and switch to another one.
+ */
+static void powerModeEnter(powerModeState_t mode, uint32_t now) {
+    powerModeTimeMs[powerModeCurrent] += now - powerModeEnteredMs;
+    powerModeEnteredMs = now;
+    powerModeCurrent = mode;
+    powerModeEntries[mode]++;
+}
+
+/**
+ * @brief Switch between active and idle, call it from the main loop.
+ *
+ * Active to idle after the timeout without motion: the IMU goes to
+ * wake-on-motion and every BMP280 to its ultra low power profile. Idle to
+ * active once the INT edge has restored the IMU (that part runs from the
+ * interrupt, so the capture restarts without waiting for this function):
+ * only the BMP280 profiles are restored here.
+ *
+ * @return None
+ */
+void powerModeProcess(void) {
+    uint32_t now = HAL_GetTick();
+
+    if (powerModeImu == NULL) {
+        return;
+    }
+
+    if (powerModeCurrent == POWER_MODE_ACTIVE) {
+        if (powerModeIdleTimeoutMs == 0 || now - powerModeLastMotionMs < powerModeIdleTimeoutMs) {
+            return;
+        }
+        if (mpu9250WomEnable(powerModeImu, powerModeThresholdMg, POWER_MODE_LP_ODR) != 0) {
+            powerModeFailures++;
+            powerModeLastMotionMs = now; /**< Retry after another timeout */
+            return;
+        }
+        for (int i = 0; i < bmp280Count; i++) {
+            powerModeBmpProfile[i] = hbmp280[i].profile;
+            bmp280SetProfile(&hbmp280[i], BMP280_PROFILE_ULTRA_LOW_POWER);
+        }
+        powerModeEnter(POWER_MODE_IDLE, now);
+    }
+    else if (powerModeImu->womState == MPU9250_WOM_OFF) {
+        for (int i = 0; i < bmp280Count; i++) {
+            bmp280SetProfile(&hbmp280[i], powerModeBmpProfile[i]);
+        }
+        powerModeLastMotionMs = now;
+        powerModeEnter(POWER_MODE_ACTIVE, now);
+    }
+}
+
+/**
+ * @brief Copy the transition counts and the time spent in each mode.
+ *
+ * @param stats Pointer to the structure receiving the values.
+ * @return None
+ */
+void powerModeGetStats(powerModeStats_t *stats) {
+    uint32_t now = HAL_GetTick();
+
+    stats->mode = powerModeCurrent;
+    for (int i = 0; i < POWER_MODE_COUNT; i++) {
+        stats->entries[i] = powerModeEntries[i];
+        stats->timeMs[i] = powerModeTimeMs[i];
+    }
+    stats->timeMs[powerModeCurrent] += now - powerModeEnteredMs;
+    stats->failures = powerModeFailures;
+    stats->idleTimeoutMs = powerModeIdleTimeoutMs;
+    stats->thresholdMg = powerModeThresholdMg;
+}
+
+/* Shell commands ------------------------------------------------------------*/
+
+/**
+ * @brief POWER [timeout_ms [threshold_mg]]: idle gating (0 = always active), or mode statistics.
+ */
+static uint8_t powerModeCmd(shell_t *shell, int argc, char **argv) {
+    powerModeStats_t stats;
+
+    if (powerModeImu == NULL) {
+        return 1;
+    }
+    if (argc > 1) {
+        powerModeGetStats(&stats);
+        powerModeInit(powerModeImu, atoi(argv[1]), argc > 2 ? atoi(argv[2]) : stats.thresholdMg);
+    }
+    powerModeGetStats(&stats);
+    Shell_Print(shell, "%s, idle after %lu ms, threshold %u mg, %lu failures\n\r",
+            stats.mode == POWER_MODE_IDLE ? "idle" : "active", stats.idleTimeoutMs, stats.thresholdMg, stats.failures);
+    Shell_Print(shell, "active: %lu entries, %lu ms; idle: %lu entries, %lu ms\n\r",
+            stats.entries[POWER_MODE_ACTIVE], stats.timeMs[POWER_MODE_ACTIVE],
+            stats.entries[POWER_MODE_IDLE], stats.timeMs[POWER_MODE_IDLE]);
+    Shell_Print(shell, "%lu wake-ups, last %lu us to full rate, %lu samples without gyro\n\r",
+            powerModeImu->stats.womWakeups, timingCyclesToUs(powerModeImu->stats.wakeCycles),
+            powerModeImu->stats.gyroInvalid);
+    return 0;
+}
+
+SHELL_COMMAND("POWER", powerModeCmd, 0, 2, "[timeout_ms [threshold_mg]]", "IMU/barometer idle gating");
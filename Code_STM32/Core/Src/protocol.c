@@ -0,0 +1,485 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    protocol.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include <math.h>
+#include <string.h>
+#include "protocol.h"
+#include "checksum.h"
+#include "uart_rx.h"
+#include "uart_tx.h"
+#include "shell.h"
+#include "motor.h"
+#include "fusion.h"
+#include "power_mode.h"
+#include "BMP280/drv_BMP280.h"
+#include "MPU9250/drv_MPU9250.h"
+
+#define PROTOCOL_READ_SIZE		32          /**< Bytes taken from the reception ring per read */
+
+/**
+ * @brief Request handler.
+ *
+ * Sends its response with protocolSend(), or leaves it to protocolProcess()
+ * for a deferred request.
+ *
+ * @return 0 if handled, a protocolError_t to send a PROTOCOL_NACK instead.
+ */
+typedef uint8_t (*protocolHandler_t)(uint8_t seq, const uint8_t *payload, uint8_t length);
+
+static UART_HandleTypeDef *protocolHuart;                   /**< NULL until protocolInit() */
+static uint8_t protocolFrame[PROTOCOL_MAX_FRAME];           /**< COBS bytes received since the last delimiter */
+static uint16_t protocolFrameLength;
+static uint8_t protocolFrameOverflow;                       /**< Frame too long, dropped at its delimiter */
+static bmp280_t *protocolEnvBmp;                            /**< GET_ENV acquisition in progress, NULL if none */
+static uint8_t protocolEnvSeq;
+static protocolStats_t protocolStats;
+
+/**
+ * @brief COBS encoding: no 0x00 left in the output, the caller appends the delimiter.
+ *
+ * @param src Bytes to encode.
+ * @param len Number of bytes.
+ * @param dst Output, at least len + len / 254 + 1 bytes.
+ * @return Number of bytes written.
+ */
+static uint16_t protocolCobsEncode(const uint8_t *src, uint16_t len, uint8_t *dst) {
+    uint16_t codeIndex = 0, out = 1;
+    uint8_t code = 1;
+
+    for (uint16_t i = 0; i < len; i++) {
+        if (src[i] != 0) {
+            dst[out++] = src[i];
+            code++;
+        }
+        if (src[i] == 0 || code == 0xFF) {
+            dst[codeIndex] = code;                          /**< Block closed by a zero or at its maximum length */
+            codeIndex = out++;
+            code = 1;
+        }
+    }
+    dst[codeIndex] = code;
+    return out;
+}
+
+/**
+ * @brief COBS decoding of a frame without its delimiter.
+ *
+ * @param src Encoded bytes.
+ * @param len Number of bytes.
+ * @param dst Output, at least len bytes.
+ * @return Number of bytes decoded, 0 on a malformed frame.
+ */
+static uint16_t protocolCobsDecode(const uint8_t *src, uint16_t len, uint8_t *dst) {
+    uint16_t in = 0, out = 0;
+
+    while (in < len) {
+        uint8_t code = src[in++];
+
+        if (code == 0 || in + code - 1 > len) {
+            return 0;
+        }
+        memcpy(&dst[out], &src[in], code - 1);
+        out += code - 1;
+        in += code - 1;
+        if (code != 0xFF && in < len) {
+            dst[out++] = 0;                                 /**< Zero removed by the encoder */
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief Frame and queue a packet.
+ *
+ * The transmit ring refuses a frame that does not fit as a whole, the Pi
+ * then times out and retries with the same seq.
+ */
+static void protocolSend(uint8_t type, uint8_t seq, const void *payload, uint8_t length) {
+    uint8_t packet[PROTOCOL_MAX_PACKET];
+    uint8_t frame[PROTOCOL_MAX_FRAME];
+    uint16_t crc, frameLength;
+
+    packet[0] = type;
+    packet[1] = seq;
+    memcpy(&packet[PROTOCOL_HEADER_SIZE], payload, length);
+    length += PROTOCOL_HEADER_SIZE;
+    crc = checksumCrc16(packet, length);
+    packet[length++] = crc & 0xFF;
+    packet[length++] = crc >> 8;
+
+    frameLength = protocolCobsEncode(packet, length, frame);
+    frame[frameLength++] = 0;
+    if (uartTxWrite(protocolHuart, frame, frameLength) != 0) {
+        protocolStats.txDropped++;
+        return;
+    }
+    protocolStats.txFrames++;
+}
+
+static void protocolNack(uint8_t type, uint8_t seq, protocolError_t error) {
+    uint8_t payload[2] = { type, error };
+
+    protocolStats.nacks++;
+    protocolSend(PROTOCOL_NACK, seq, payload, sizeof(payload));
+}
+
+/**
+ * @brief Float to int16 with rounding, saturated instead of wrapped.
+ */
+static int16_t protocolToInt16(float value) {
+    if (value >= INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (value <= INT16_MIN + 1) {
+        return INT16_MIN + 1;                               /**< INT16_MIN flags an invalid value */
+    }
+    return lroundf(value);
+}
+
+/**
+ * @brief Current value of a configuration key.
+ *
+ * @return 0 on success, a protocolError_t otherwise.
+ */
+static uint8_t protocolConfigGet(uint8_t key, int32_t *value) {
+    powerModeStats_t stats;
+
+    switch (key) {
+    case PROTOCOL_CONFIG_IMU_PROFILE:
+        *value = hmpu9250.profile;
+        return 0;
+    case PROTOCOL_CONFIG_BMP_PROFILE:
+        if (bmp280Count == 0) {
+            return PROTOCOL_ERROR_DEVICE;
+        }
+        *value = hbmp280[0].profile;
+        return 0;
+    case PROTOCOL_CONFIG_FUSION_GAIN:
+        *value = lroundf(hfusion.gain * 1000.0f);
+        return 0;
+    case PROTOCOL_CONFIG_IDLE_TIMEOUT:
+        powerModeGetStats(&stats);
+        *value = stats.idleTimeoutMs;
+        return 0;
+    default:
+        return PROTOCOL_ERROR_KEY;
+    }
+}
+
+/**
+ * @brief Apply a configuration key, same checks as the matching shell commands.
+ *
+ * @return 0 on success, a protocolError_t otherwise.
+ */
+static uint8_t protocolConfigSet(uint8_t key, int32_t value) {
+    powerModeStats_t stats;
+
+    switch (key) {
+    case PROTOCOL_CONFIG_IMU_PROFILE:
+        if (value < 0 || value >= MPU9250_PROFILE_COUNT) {
+            return PROTOCOL_ERROR_LENGTH;
+        }
+        return mpu9250SetProfile(&hmpu9250, value) != 0 ? PROTOCOL_ERROR_DEVICE : 0;
+    case PROTOCOL_CONFIG_BMP_PROFILE:
+        if (value < 0 || value >= BMP280_PROFILE_COUNT) {
+            return PROTOCOL_ERROR_LENGTH;
+        }
+        if (bmp280Count == 0) {
+            return PROTOCOL_ERROR_DEVICE;
+        }
+        if (protocolEnvBmp != NULL || Shell_Busy()) {
+            return PROTOCOL_ERROR_BUSY;                     /**< Not while an acquisition is pending */
+        }
+        return bmp280SetProfile(&hbmp280[0], value) != 0 ? PROTOCOL_ERROR_DEVICE : 0;
+    case PROTOCOL_CONFIG_FUSION_GAIN:
+        if (value < 0) {
+            return PROTOCOL_ERROR_LENGTH;
+        }
+        fusionSetGain(&hfusion, value / 1000.0f);
+        return 0;
+    case PROTOCOL_CONFIG_IDLE_TIMEOUT:
+        if (value < 0) {
+            return PROTOCOL_ERROR_LENGTH;
+        }
+        powerModeGetStats(&stats);
+        powerModeInit(&hmpu9250, value, stats.thresholdMg);
+        return 0;
+    default:
+        return PROTOCOL_ERROR_KEY;
+    }
+}
+
+/* Request handlers ----------------------------------------------------------*/
+
+static uint8_t protocolPing(uint8_t seq, const uint8_t *payload, uint8_t length) {
+    protocolSend(PROTOCOL_PING | PROTOCOL_RESPONSE, seq, payload, length);
+    return 0;
+}
+
+/**
+ * @brief GET_ENV: start the acquisition, protocolProcess() answers on completion.
+ */
+static uint8_t protocolGetEnv(uint8_t seq, const uint8_t *payload, uint8_t length) {
+    uint8_t sensor = length > 0 ? payload[0] : 0;
+
+    if (length > 1 || sensor >= bmp280Count) {
+        return PROTOCOL_ERROR_LENGTH;
+    }
+    if (protocolEnvBmp != NULL || bmp280StartMeasure(&hbmp280[sensor]) != 0) {
+        return PROTOCOL_ERROR_BUSY;
+    }
+    protocolEnvBmp = &hbmp280[sensor];
+    protocolEnvSeq = seq;
+    return 0;
+}
+
+static uint8_t protocolGetImu(uint8_t seq, const uint8_t *payload, uint8_t length) {
+    mpu9250Sample_t sample;
+    int16_t values[10];
+
+    if (length != 0) {
+        return PROTOCOL_ERROR_LENGTH;
+    }
+    if (mpu9250Read(&hmpu9250, &sample) != 0) {
+        return PROTOCOL_ERROR_DEVICE;
+    }
+    for (int i = 0; i < 3; i++) {
+        values[i] = protocolToInt16(sample.accel[i] * 1000.0f);
+        values[3 + i] = protocolToInt16(sample.gyro[i] * 10.0f);
+        values[6 + i] = sample.magValid ? protocolToInt16(sample.mag[i] * 10.0f) : INT16_MIN;
+    }
+    values[9] = protocolToInt16(sample.temperature * 100.0f);
+    protocolSend(PROTOCOL_GET_IMU | PROTOCOL_RESPONSE, seq, values, sizeof(values)); /**< The Cortex-M4 is little-endian */
+    return 0;
+}
+
+static uint8_t protocolGetOrient(uint8_t seq, const uint8_t *payload, uint8_t length) {
+    fusionQuaternion_t q;
+    fusionEuler_t euler;
+    int16_t values[3];
+
+    if (length != 0) {
+        return PROTOCOL_ERROR_LENGTH;
+    }
+    __disable_irq(); // updated from the I2C DMA interrupt
+    q = hfusion.q;
+    __enable_irq();
+    fusionGetEuler(&q, &euler);
+    values[0] = protocolToInt16(euler.roll * 100.0f);
+    values[1] = protocolToInt16(euler.pitch * 100.0f);
+    values[2] = protocolToInt16(euler.yaw * 100.0f);
+    protocolSend(PROTOCOL_GET_ORIENT | PROTOCOL_RESPONSE, seq, values, sizeof(values));
+    return 0;
+}
+
+static uint8_t protocolSetMotor(uint8_t seq, const uint8_t *payload, uint8_t length) {
+    if (length != 2 || payload[1] > 1) {
+        return PROTOCOL_ERROR_LENGTH;
+    }
+    motorSetPosition(payload[0], payload[1]);
+    protocolSend(PROTOCOL_SET_MOTOR | PROTOCOL_RESPONSE, seq, payload, 0);
+    return 0;
+}
+
+/**
+ * @brief Answer SET_CONFIG / GET_CONFIG with the current value of a key.
+ */
+static uint8_t protocolConfigReply(uint8_t type, uint8_t seq, uint8_t key) {
+    uint8_t response[1 + sizeof(int32_t)];
+    int32_t value;
+    uint8_t err = protocolConfigGet(key, &value);
+
+    if (err != 0) {
+        return err;
+    }
+    response[0] = key;
+    memcpy(&response[1], &value, sizeof(value));
+    protocolSend(type | PROTOCOL_RESPONSE, seq, response, sizeof(response));
+    return 0;
+}
+
+/**
+ * @brief SET_CONFIG: apply, then answer with the value read back.
+ */
+static uint8_t protocolSetConfig(uint8_t seq, const uint8_t *payload, uint8_t length) {
+    int32_t value;
+    uint8_t err;
+
+    if (length != 1 + sizeof(value)) {
+        return PROTOCOL_ERROR_LENGTH;
+    }
+    memcpy(&value, &payload[1], sizeof(value));
+    err = protocolConfigSet(payload[0], value);
+    if (err != 0) {
+        return err;
+    }
+    return protocolConfigReply(PROTOCOL_SET_CONFIG, seq, payload[0]);
+}
+
+static uint8_t protocolGetConfig(uint8_t seq, const uint8_t *payload, uint8_t length) {
+    if (length != 1) {
+        return PROTOCOL_ERROR_LENGTH;
+    }
+    return protocolConfigReply(PROTOCOL_GET_CONFIG, seq, payload[0]);
+}
+
+static const protocolHandler_t protocolHandlers[PROTOCOL_TYPE_COUNT] = {
+    [PROTOCOL_PING]       = protocolPing,
+    [PROTOCOL_GET_ENV]    = protocolGetEnv,
+    [PROTOCOL_GET_IMU]    = protocolGetImu,
+    [PROTOCOL_GET_ORIENT] = protocolGetOrient,
+    [PROTOCOL_SET_MOTOR]  = protocolSetMotor,
+    [PROTOCOL_SET_CONFIG] = protocolSetConfig,
+    [PROTOCOL_GET_CONFIG] = protocolGetConfig,
+};
+
+/**
+ * @brief Check and dispatch the frame accumulated up to a delimiter.
+ *
+ * A frame with a bad CRC gets no answer: its seq cannot be trusted.
+ */
+static void protocolHandleFrame(void) {
+    uint8_t packet[PROTOCOL_MAX_FRAME];
+    uint16_t length = protocolCobsDecode(protocolFrame, protocolFrameLength, packet);
+    uint8_t type, seq, err;
+
+    if (length < PROTOCOL_HEADER_SIZE + PROTOCOL_CRC_SIZE) {
+        protocolStats.crcErrors++;
+        return;
+    }
+    length -= PROTOCOL_CRC_SIZE;
+    if (checksumCrc16(packet, length) != (packet[length] | packet[length + 1] << 8)) {
+        protocolStats.crcErrors++;
+        return;
+    }
+    protocolStats.rxFrames++;
+
+    type = packet[0];
+    seq = packet[1];
+    length -= PROTOCOL_HEADER_SIZE;
+    if (type >= PROTOCOL_TYPE_COUNT || protocolHandlers[type] == NULL) {
+        err = PROTOCOL_ERROR_TYPE;
+    }
+    else if (length > PROTOCOL_MAX_PAYLOAD) {
+        err = PROTOCOL_ERROR_LENGTH;
+    }
+    else {
+        err = protocolHandlers[type](seq, &packet[PROTOCOL_HEADER_SIZE], length);
+    }
+    if (err != 0) {
+        protocolNack(type, seq, err);
+    }
+}
+
+/**
+ * @brief Start the protocol on a UART.
+ *
+ * The port is taken over entirely: no shell session may run on it.
+ *
+ * @param huart UART linked to the Raspberry Pi.
+ * @return 0 on success, 1 if the DMA reception or transmission cannot start.
+ */
+uint8_t protocolInit(UART_HandleTypeDef *huart) {
+    protocolFrameLength = 0;
+    protocolFrameOverflow = 0;
+    protocolEnvBmp = NULL;
+    protocolStats = (protocolStats_t){0};
+    if (uartRxInit(huart) != 0 || uartTxInit(huart) != 0) {
+        protocolHuart = NULL;
+        return 1;
+    }
+    protocolHuart = huart;
+    return 0;
+}
+
+/**
+ * @brief Handle the received frames and complete a pending GET_ENV.
+ *
+ * Called from the main loop, never blocks on the UART.
+ */
+void protocolProcess(void) {
+    uint8_t block[PROTOCOL_READ_SIZE];
+    uint16_t length;
+
+    if (protocolHuart == NULL) {
+        return;
+    }
+    while ((length = uartRxRead(protocolHuart, block, sizeof(block))) > 0) {
+        for (uint16_t i = 0; i < length; i++) {
+            if (block[i] != 0) {
+                if (protocolFrameLength < sizeof(protocolFrame)) {
+                    protocolFrame[protocolFrameLength++] = block[i];
+                }
+                else {
+                    protocolFrameOverflow = 1;
+                }
+                continue;
+            }
+            if (protocolFrameOverflow) {
+                protocolStats.overflows++;
+            }
+            else if (protocolFrameLength > 0) {
+                protocolHandleFrame();                      /**< Empty frames are idle delimiters, resync */
+            }
+            protocolFrameLength = 0;
+            protocolFrameOverflow = 0;
+        }
+    }
+
+    if (protocolEnvBmp != NULL) {
+        bmp280Measure_t meas;
+        bmp280State_t state = bmp280PollMeasure(protocolEnvBmp, &meas);
+        uint32_t response[2];
+
+        if (state == BMP280_STATE_BUSY) {
+            return;
+        }
+        if (state != BMP280_STATE_READY) {
+            protocolNack(PROTOCOL_GET_ENV, protocolEnvSeq, PROTOCOL_ERROR_DEVICE);
+        }
+        else {
+            response[0] = meas.temperature;
+            response[1] = meas.pressure;
+            protocolSend(PROTOCOL_GET_ENV | PROTOCOL_RESPONSE, protocolEnvSeq, response, sizeof(response));
+        }
+        protocolEnvBmp = NULL;
+    }
+}
+
+/**
+ * @brief Protocol statistics.
+ */
+const protocolStats_t* protocolGetStats(void) {
+    return &protocolStats;
+}
+
+/* Shell commands ------------------------------------------------------------*/
+
+/**
+ * @brief PROTO: binary protocol statistics.
+ */
+static uint8_t protocolCmdStat(shell_t *shell, int argc, char **argv) {
+    if (protocolHuart == NULL) {
+        return 1;
+    }
+    Shell_Print(shell, "usart%d: %lu requests, %lu nacks, %lu crc errors, %lu overflows\r\n",
+            protocolHuart->Instance == USART1 ? 1 : 2,
+            protocolStats.rxFrames, protocolStats.nacks, protocolStats.crcErrors, protocolStats.overflows);
+    Shell_Print(shell, "%lu responses, %lu dropped\r\n", protocolStats.txFrames, protocolStats.txDropped);
+    return 0;
+}
+
+SHELL_COMMAND("PROTO", protocolCmdStat, 0, 0, "", "binary protocol statistics");
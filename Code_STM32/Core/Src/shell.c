@@ -16,10 +16,10 @@
 #include "main.h"
 #include "usart.h"
 #include <stdio.h>
-#include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
-#include "BMP280/drv_BMP280.h"
-#include "motor.h"
+#include "uart_rx.h"
+#include "uart_tx.h"
 #include "shell.h"
 
 uint8_t prompt[]="user@Nucleo-STM32F446>>";
@@ -27,112 +27,276 @@ uint8_t cmdNotFound[]="Command not found\r\n";
 uint8_t brian[]="Brian is in the kitchen\r\n";
 uint8_t newline[]="\r\n";
 uint8_t backspace[]="\b \b";
-uint8_t uartRxReceived;
-uint8_t uartRxBufferRasp[UART_RX_BUFFER_SIZE];
-uint8_t uartRxBufferPC[UART_RX_BUFFER_SIZE];
-uint8_t uartRxBuffer[UART_RX_BUFFER_SIZE];
 uint8_t uartTxBuffer[UART_TX_BUFFER_SIZE];
 
-char	 	cmdBuffer[CMD_BUFFER_SIZE];
-int 		idx_cmd;
-char* 		argv[MAX_ARGS];
-int		 	argc = 0;
-char*		token;
-int 		newCmdReady = 0;
+/* Session of one UART: line being typed, parsed command and output port.
+   The sessions only share uartTxBuffer, filled and sent within one Shell_Print(). */
+struct shell_s {
+	UART_HandleTypeDef*	huart;
+	uint8_t		rxBuffer[UART_RX_BUFFER_SIZE];
+	uint16_t	rxLength;		// bytes in rxBuffer
+	uint16_t	rxIndex;		// next byte of rxBuffer to parse
+	char	 	cmdBuffer[CMD_BUFFER_SIZE];
+	int 		idx_cmd;
+	char* 		argv[MAX_ARGS];
+	int		 	argc;
+	int 		newCmdReady;
+	shellPoll_t	poll;			// completion of a deferred command, NULL when none
+	void*		pollContext;
+};
+
+static shell_t shells[SHELL_PORT_COUNT];
+
+/* Output of a command goes back to the port it came from only. Queued for the DMA
+   (uart_tx.c): returns at once, a write that does not fit is dropped and counted. */
+void Shell_Write(shell_t* shell, const uint8_t* data, uint16_t length){
+	if(length > 0){
+		uartTxWrite(shell->huart, data, length);
+	}
+}
+
+/* printf to the session, one line of at most UART_TX_BUFFER_SIZE - 1 characters */
+void Shell_Print(shell_t* shell, const char* format, ...){
+	va_list args;
+	int length;
+
+	va_start(args, format);
+	length = vsnprintf((char *)uartTxBuffer, UART_TX_BUFFER_SIZE, format, args);
+	va_end(args);
+	if(length >= UART_TX_BUFFER_SIZE){
+		length = UART_TX_BUFFER_SIZE - 1;
+	}
+	if(length > 0){
+		Shell_Write(shell, uartTxBuffer, length);
+	}
+}
+
+/* Free bytes in the transmit ring of the session. A dump longer than the ring prints
+   while a line still fits, then defers the rest until the DMA has drained it. */
+uint16_t Shell_Room(shell_t* shell){
+	return UART_TX_RING_SIZE - uartTxLevel(shell->huart);
+}
+
+/* Called by a handler whose reply comes later: the prompt waits until poll() returns 0,
+   the loop keeps serving the other session, UART and CAN meanwhile */
+void Shell_Defer(shell_t* shell, shellPoll_t poll, void* context){
+	shell->poll = poll;
+	shell->pollContext = context;
+}
+
+/* Nonzero while a session waits for a deferred command */
+uint8_t Shell_Busy(void){
+	for(int i = 0; i < SHELL_PORT_COUNT; i++){
+		if(shells[i].poll != NULL){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Commands registered with SHELL_COMMAND(), bounds provided by the linker script */
+extern const shellCommand_t __shell_cmd_start[];
+extern const shellCommand_t __shell_cmd_end[];
+
+/* Open addressing table over the .shell_cmd section, filled once by Shell_Init() */
+static const shellCommand_t* shellHash[SHELL_HASH_SIZE];
+static int shellCommandCount;
+
+/* FNV-1a. The table is kept at most half full, so a lookup is one hash of the name
+   and, on average, less than two string compares whatever the number of commands. */
+static uint32_t Shell_Hash(const char* name){
+	uint32_t hash = 2166136261u;
+
+	while(*name){
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static const shellCommand_t* Shell_Find(const char* name){
+	uint32_t slot = Shell_Hash(name);
+
+	for(int i = 0; i < SHELL_HASH_SIZE; i++){
+		const shellCommand_t* cmd = shellHash[(slot + i) & (SHELL_HASH_SIZE - 1)];
+		if(cmd == NULL){
+			return NULL;
+		}
+		if(strcmp(cmd->name, name) == 0){
+			return cmd;
+		}
+	}
+	return NULL;
+}
+
+/* Add a command to the table. Returns 1 for a duplicated name or a half full table
+   (raise SHELL_HASH_SIZE). */
+static uint8_t Shell_Insert(const shellCommand_t* cmd){
+	uint32_t slot = Shell_Hash(cmd->name);
+
+	if(shellCommandCount >= SHELL_HASH_SIZE / 2){
+		return 1;
+	}
+	for(int i = 0; i < SHELL_HASH_SIZE; i++){
+		const shellCommand_t** entry = &shellHash[(slot + i) & (SHELL_HASH_SIZE - 1)];
+		if(*entry == NULL){
+			*entry = cmd;
+			shellCommandCount++;
+			return 0;
+		}
+		if(strcmp((*entry)->name, cmd->name) == 0){
+			return 1;
+		}
+	}
+	return 1;
+}
+
+/* Index every registered command, rejected ones are reported on the consoles */
+static void Shell_Register(void){
+	for(const shellCommand_t* cmd = __shell_cmd_start; cmd < __shell_cmd_end; cmd++){
+		if(Shell_Insert(cmd) != 0){
+			for(int i = 0; i < SHELL_PORT_COUNT; i++){
+				Shell_Print(&shells[i], "shell: %s not registered\r\n", cmd->name);
+			}
+		}
+	}
+}
 
 void Shell_Init(void){
-	memset(argv, NULL, MAX_ARGS*sizeof(char*));
-	memset(cmdBuffer, NULL, CMD_BUFFER_SIZE*sizeof(char));
-	memset(uartRxBuffer, NULL, UART_RX_BUFFER_SIZE*sizeof(char));
-	memset(uartRxBufferRasp, NULL, UART_RX_BUFFER_SIZE*sizeof(char));
-	memset(uartRxBufferPC, NULL, UART_RX_BUFFER_SIZE*sizeof(char));
+	UART_HandleTypeDef* ports[SHELL_PORT_COUNT] = {&huart2};
+
+	memset(shells, 0, sizeof(shells));
+	memset(shellHash, 0, sizeof(shellHash));
+	shellCommandCount = 0;
 	memset(uartTxBuffer, NULL, UART_TX_BUFFER_SIZE*sizeof(char));
 
-	HAL_UART_Receive_IT(&huart2, uartRxBufferPC, UART_RX_BUFFER_SIZE);
-	//HAL_UART_Receive_IT(&huart1, uartRxBufferRasp, UART_RX_BUFFER_SIZE);
-	HAL_UART_Transmit(&huart2, prompt, strlen((char *)prompt), HAL_MAX_DELAY);
-	HAL_UART_Transmit(&huart1, prompt, strlen((char *)prompt), HAL_MAX_DELAY);
+	for(int i = 0; i < SHELL_PORT_COUNT; i++){
+		shells[i].huart = ports[i];
+		uartRxInit(ports[i]);
+		uartTxInit(ports[i]);
+	}
+	Shell_Register();
+	for(int i = 0; i < SHELL_PORT_COUNT; i++){
+		Shell_Write(&shells[i], prompt, sizeof(prompt) - 1);
+	}
 }
 
-void Shell_Loop(void){
-	if(uartRxReceived){
-		switch(uartRxBuffer[0]){
+/* Parse the received bytes up to the end of the next command line.
+   Bytes are taken from the DMA ring by blocks and echoed by runs, not one by one. */
+static void Shell_Receive(shell_t* shell){
+	uint8_t echo[UART_RX_BUFFER_SIZE];
+	uint16_t echoLength = 0;
+	char* token;
+	uint8_t c;
+
+	while(!shell->newCmdReady){
+		if(shell->rxIndex >= shell->rxLength){
+			shell->rxIndex = 0;
+			shell->rxLength = uartRxRead(shell->huart, shell->rxBuffer, UART_RX_BUFFER_SIZE);
+			if(shell->rxLength == 0){
+				break;
+			}
+		}
+		c = shell->rxBuffer[shell->rxIndex++];
+
+		switch(c){
 		case ASCII_CR: // Nouvelle ligne, instruction à traiter
-			HAL_UART_Transmit(&huart2, newline, sizeof(newline), HAL_MAX_DELAY);
-			HAL_UART_Transmit(&huart1, newline, sizeof(newline), HAL_MAX_DELAY);
-			cmdBuffer[idx_cmd] = '\0';
-			argc = 0;
-			token = strtok(cmdBuffer, " ");
-			while(token!=NULL){
-				argv[argc++] = token;
+			Shell_Write(shell, echo, echoLength);
+			echoLength = 0;
+			Shell_Write(shell, newline, sizeof(newline) - 1);
+			shell->cmdBuffer[shell->idx_cmd] = '\0';
+			shell->argc = 0;
+			token = strtok(shell->cmdBuffer, " ");
+			while(token!=NULL && shell->argc < MAX_ARGS){
+				shell->argv[shell->argc++] = token;
 				token = strtok(NULL, " ");
 			}
-			idx_cmd = 0;
-			newCmdReady = 1;
+			shell->idx_cmd = 0;
+			shell->newCmdReady = shell->argc > 0;
+			if(!shell->newCmdReady){
+				Shell_Write(shell, prompt, sizeof(prompt) - 1);
+			}
 			break;
 		case ASCII_BACK: // Suppression du dernier caractère
-			cmdBuffer[idx_cmd--] = '\0';
-			HAL_UART_Transmit(&huart2, backspace, sizeof(backspace), HAL_MAX_DELAY);
-			HAL_UART_Transmit(&huart1, backspace, sizeof(backspace), HAL_MAX_DELAY);
+			if(shell->idx_cmd > 0){
+				shell->cmdBuffer[--shell->idx_cmd] = '\0';
+				Shell_Write(shell, echo, echoLength);
+				echoLength = 0;
+				Shell_Write(shell, backspace, sizeof(backspace) - 1);
+			}
+			break;
+		case ASCII_LF: // CR LF envoyé par les scripts, le CR a déjà terminé la ligne
 			break;
 
 		default: // Nouveau caractère
-			cmdBuffer[idx_cmd++] = uartRxBuffer[0];
-			HAL_UART_Transmit(&huart2, uartRxBuffer, UART_RX_BUFFER_SIZE, HAL_MAX_DELAY);
-			HAL_UART_Transmit(&huart1, uartRxBuffer, UART_RX_BUFFER_SIZE, HAL_MAX_DELAY);
+			if(shell->idx_cmd < CMD_BUFFER_SIZE - 1){
+				shell->cmdBuffer[shell->idx_cmd++] = c;
+				echo[echoLength++] = c;
+			}
 		}
-		uartRxReceived = 0;
 	}
+	Shell_Write(shell, echo, echoLength);
+}
 
-	if(newCmdReady){
-		if(strcmp(argv[0],"WhereisBrian?")==0){
-			HAL_UART_Transmit(&huart2, brian, sizeof(brian), HAL_MAX_DELAY);
-		}
-		else if(strcmp(argv[0],"GET_T")==0){
-			BMP280_S32_t temp = bmp280GetCompensateTemp();
-			sprintf(uartTxBuffer, "T = %ld_C\n\r", temp);
-			HAL_UART_Transmit(&huart2, uartTxBuffer, sizeof(uartTxBuffer), HAL_MAX_DELAY);
-			HAL_UART_Transmit(&huart1, uartTxBuffer, sizeof(uartTxBuffer), HAL_MAX_DELAY);
-			//motorSetPositionDenpendingTemperature();
-		}
-		else if(strcmp(argv[0],"GET_P")==0){
-			BMP280_S32_t press = bmp280GetCompensatePress();
-			sprintf(uartTxBuffer, "P = %d Pa\n\r", press);
-			HAL_UART_Transmit(&huart2, uartTxBuffer, sizeof(uartTxBuffer), HAL_MAX_DELAY);
-			HAL_UART_Transmit(&huart1, uartTxBuffer, sizeof(uartTxBuffer), HAL_MAX_DELAY);
-		}
-		else if(strcmp(argv[0],"GO_TO")==0){
-			//HAL_UART_Transmit(&huart1, press, sizeof(press), HAL_MAX_DELAY);
-			uint8_t positionAngle = 0;
-			positionAngle = atoi(&argv[1]);
-			motorSetPosition(positionAngle, 1);
-			sprintf(uartTxBuffer, "Go to %d°\n\r", positionAngle);
-			HAL_UART_Transmit(&huart2, uartTxBuffer, sizeof(uartTxBuffer), HAL_MAX_DELAY);
-		}
-		else if(strcmp(argv[0],"GET_K")==0){
-			//HAL_UART_Transmit(&huart1, press, sizeof(press), HAL_MAX_DELAY);
-		}
-		else if(strcmp(argv[0],"GET_A")==0){
-			//HAL_UART_Transmit(&huart1, press, sizeof(press), HAL_MAX_DELAY);
+static void Shell_Execute(shell_t* shell){
+	const shellCommand_t* cmd = Shell_Find(shell->argv[0]);
+	int args = shell->argc - 1;
+
+	if(cmd == NULL){
+		Shell_Write(shell, cmdNotFound, sizeof(cmdNotFound) - 1);
+	}
+	else if(args < cmd->minArgs || args > cmd->maxArgs || cmd->handler(shell, shell->argc, shell->argv) != 0){
+		Shell_Print(shell, "usage: %s %s\r\n", cmd->name, cmd->usage);
+	}
+}
+
+static void Shell_Process(shell_t* shell){
+	if(shell->poll != NULL){
+		if(shell->poll(shell, shell->pollContext) != 0){
+			return;
 		}
-		else{
-			HAL_UART_Transmit(&huart2, cmdNotFound, sizeof(cmdNotFound), HAL_MAX_DELAY);
-			HAL_UART_Transmit(&huart1, cmdNotFound, sizeof(cmdNotFound), HAL_MAX_DELAY);
+		shell->poll = NULL;
+		Shell_Write(shell, prompt, sizeof(prompt) - 1);
+	}
+
+	Shell_Receive(shell); // stops at the end of a line, the command runs before the next one is parsed
+
+	if(shell->newCmdReady){
+		Shell_Execute(shell);
+		if(shell->poll == NULL){
+			Shell_Write(shell, prompt, sizeof(prompt) - 1);
 		}
-		HAL_UART_Transmit(&huart2, prompt, sizeof(prompt), HAL_MAX_DELAY);
-		HAL_UART_Transmit(&huart1, prompt, sizeof(prompt), HAL_MAX_DELAY);
-		newCmdReady = 0;
+		shell->newCmdReady = 0;
 	}
 }
 
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef * huart){
-	if(huart->Instance == USART1) {
-		uartRxBuffer[0] = uartRxBufferRasp[0];
-		//HAL_UART_Receive_IT(&huart1, uartRxBufferRasp, UART_RX_BUFFER_SIZE);
+void Shell_Loop(void){
+	for(int i = 0; i < SHELL_PORT_COUNT; i++){
+		Shell_Process(&shells[i]);
 	}
-	else if(huart->Instance == USART2) {
-		uartRxBuffer[0] = uartRxBufferPC[0];
-		HAL_UART_Receive_IT(&huart2, uartRxBufferPC, UART_RX_BUFFER_SIZE);
+}
+
+static uint8_t Shell_CmdBrian(shell_t* shell, int argc, char** argv){
+	Shell_Write(shell, brian, sizeof(brian) - 1);
+	return 0;
+}
+
+static uint8_t Shell_CmdHelp(shell_t* shell, int argc, char** argv){
+	const shellCommand_t* cmd;
+
+	if(argc > 1){
+		cmd = Shell_Find(argv[1]);
+		if(cmd == NULL){
+			return 1;
+		}
+		Shell_Print(shell, "%s %s: %s\r\n", cmd->name, cmd->usage, cmd->help);
+		return 0;
+	}
+	for(cmd = __shell_cmd_start; cmd < __shell_cmd_end; cmd++){
+		Shell_Print(shell, "%-13s %s\r\n", cmd->name, cmd->help);
 	}
-	uartRxReceived = 1;
-}
\ No newline at end of file
+	return 0;
+}
+
+SHELL_COMMAND("WhereisBrian?", Shell_CmdBrian, 0, 0, "", "where is Brian");
+SHELL_COMMAND("HELP", Shell_CmdHelp, 0, 1, "[command]", "list the commands, or the arguments of one");
@@ -0,0 +1,74 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    timing.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include "timing.h"
+
+/**
+ * @brief Enable the DWT cycle counter.
+ *
+ * The counter runs at the core clock (SystemCoreClock) and is used to measure
+ * the CPU time spent in drivers and algorithms.
+ *
+ * @return None
+ */
+void timingInit(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; /**< Enable the trace block */
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;            /**< Start counting core cycles */
+}
+
+/**
+ * @brief Microseconds since boot, built from HAL tick and SysTick counter.
+ *
+ * @return Elapsed time in microseconds (wraps after ~71 minutes).
+ */
+uint32_t timingMicros(void) {
+    uint32_t ms, val;
+    uint32_t load = SysTick->LOAD + 1;
+
+    do {
+        ms = HAL_GetTick();
+        val = SysTick->VAL;
+    } while (ms != HAL_GetTick()); /**< Retry if the tick interrupt fired in between */
+
+    return ms * 1000U + ((load - val) * 1000U) / load;
+}
+
+/**
+ * @brief Convert a number of core cycles to microseconds.
+ *
+ * @param cycles Cycle count measured with timingCycles().
+ * @return Duration in microseconds.
+ */
+uint32_t timingCyclesToUs(uint32_t cycles) {
+    return cycles / (SystemCoreClock / 1000000U);
+}
+
+/**
+ * @brief Busy-wait for a number of microseconds on the cycle counter.
+ *
+ * Usable with interrupts disabled, unlike HAL_Delay().
+ *
+ * @param us Delay in microseconds.
+ * @return None
+ */
+void timingDelayUs(uint32_t us) {
+    uint32_t start = timingCycles();
+    uint32_t cycles = us * (SystemCoreClock / 1000000U);
+
+    while ((timingCycles() - start) < cycles) {
+    }
+}
@@ -0,0 +1,210 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    uart_rx.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include <string.h>
+#include "uart_rx.h"
+#include "shell.h"
+
+/**
+ * @brief Reception ring of one port.
+ *
+ * The DMA runs in circular mode over the ring and never stops. The RX event
+ * interrupt only advances the byte counter; the reader position is a second
+ * free-running counter, so the ring level is received - consumed and an
+ * overrun is a level above the ring size.
+ */
+typedef struct uartRx_s {
+    UART_HandleTypeDef *huart;                              /**< NULL while the port is not started */
+    uint8_t ring[UART_RX_RING_SIZE];                        /**< Written by the DMA only */
+    volatile uint32_t received;                             /**< Bytes written since start, interrupt side */
+    uint32_t consumed;                                      /**< Bytes read since start, main loop side */
+    uint16_t dmaPos;                                        /**< Ring index at the last RX event */
+    uartRxStats_t stats;
+} uartRx_t;
+
+static uartRx_t uartRxPorts[UART_RX_PORT_COUNT];
+
+/**
+ * @brief Reception ring of a UART.
+ *
+ * @return The ring, NULL if uartRxInit() was not called for this UART.
+ */
+static uartRx_t *uartRxGet(UART_HandleTypeDef *huart) {
+    for (int i = 0; i < UART_RX_PORT_COUNT; i++) {
+        if (uartRxPorts[i].huart == huart) {
+            return &uartRxPorts[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief (Re)start the circular DMA reception from the start of the ring.
+ *
+ * The UART error interrupts are masked: in DMA mode the HAL aborts the whole
+ * reception on a framing, noise or overrun error, while the DMA is able to
+ * carry on by itself (the faulty byte is lost, nothing else).
+ *
+ * @return 0 if the reception runs, 1 otherwise.
+ */
+static uint8_t uartRxStart(uartRx_t *rx) {
+    rx->received = 0;
+    rx->consumed = 0;
+    rx->dmaPos = 0;
+    if (HAL_UARTEx_ReceiveToIdle_DMA(rx->huart, rx->ring, UART_RX_RING_SIZE) != HAL_OK) {
+        return 1;
+    }
+    __HAL_UART_DISABLE_IT(rx->huart, UART_IT_PE);
+    __HAL_UART_DISABLE_IT(rx->huart, UART_IT_ERR);
+    return 0;
+}
+
+/**
+ * @brief Start the reception of a UART into its ring.
+ *
+ * The UART must have a circular RX DMA stream linked (usart.c).
+ *
+ * @param huart UART to receive from.
+ * @return 0 on success, 1 if no port is left or the DMA could not start.
+ */
+uint8_t uartRxInit(UART_HandleTypeDef *huart) {
+    uartRx_t *rx = uartRxGet(huart);
+
+    if (rx == NULL) {
+        rx = uartRxGet(NULL);
+        if (rx == NULL || huart->hdmarx == NULL || huart->hdmarx->Init.Mode != DMA_CIRCULAR) {
+            return 1;
+        }
+        rx->huart = huart;
+    }
+    rx->stats = (uartRxStats_t){0};
+    if (uartRxStart(rx) != 0) {
+        rx->huart = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Copy the received bytes out of the ring.
+ *
+ * Bytes become visible at each RX event (line idle, half ring, full ring).
+ * If the main loop fell more than a ring behind, the oldest bytes are lost:
+ * they are counted as overruns and reading resumes at the oldest valid byte.
+ * A reception stopped by the HAL is restarted here.
+ *
+ * @param huart UART to read from.
+ * @param data Destination.
+ * @param size Size of the destination.
+ * @return Number of bytes copied, 0 if none.
+ */
+uint16_t uartRxRead(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size) {
+    uartRx_t *rx = uartRxGet(huart);
+    uint32_t level;
+    uint16_t pos, chunk, count = 0;
+
+    if (rx == NULL) {
+        return 0;
+    }
+    if (huart->RxState != HAL_UART_STATE_BUSY_RX) {
+        rx->stats.restarts++;
+        rx->stats.overruns += rx->received - rx->consumed;
+        uartRxStart(rx);
+        return 0;
+    }
+
+    level = rx->received - rx->consumed;
+    if (level > UART_RX_RING_SIZE) {
+        rx->stats.overruns += level - UART_RX_RING_SIZE;
+        rx->consumed += level - UART_RX_RING_SIZE;
+        level = UART_RX_RING_SIZE;
+    }
+    if (level > rx->stats.maxLevel) {
+        rx->stats.maxLevel = level;
+    }
+
+    if (size > level) {
+        size = level;
+    }
+    while (count < size) {
+        pos = rx->consumed % UART_RX_RING_SIZE;
+        chunk = UART_RX_RING_SIZE - pos;
+        if (chunk > size - count) {
+            chunk = size - count;
+        }
+        memcpy(&data[count], &rx->ring[pos], chunk);
+        count += chunk;
+        rx->consumed += chunk;
+    }
+    return count;
+}
+
+/**
+ * @brief Reception statistics of a UART.
+ *
+ * @return The statistics, NULL if uartRxInit() was not called for this UART.
+ */
+const uartRxStats_t* uartRxGetStats(UART_HandleTypeDef *huart) {
+    uartRx_t *rx = uartRxGet(huart);
+
+    return rx != NULL ? &rx->stats : NULL;
+}
+
+/**
+ * @brief RX event: line idle, half ring or full ring.
+ *
+ * Size is the ring index the DMA has reached, only the bytes since the
+ * previous event are accounted.
+ */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+    uartRx_t *rx = uartRxGet(huart);
+    uint16_t pos = Size % UART_RX_RING_SIZE;
+    uint16_t len;
+
+    if (rx == NULL) {
+        return;
+    }
+    len = (pos + UART_RX_RING_SIZE - rx->dmaPos) % UART_RX_RING_SIZE;
+    if (len == 0 && Size == UART_RX_RING_SIZE) {
+        len = UART_RX_RING_SIZE;                            /**< Full ring with no event since the last wrap */
+    }
+    rx->dmaPos = pos;
+    rx->received += len;
+    rx->stats.bytes += len;
+    rx->stats.events++;
+}
+
+/* Shell commands ------------------------------------------------------------*/
+
+/**
+ * @brief UART_STAT: reception statistics of every started port.
+ */
+static uint8_t uartRxCmdStat(shell_t *shell, int argc, char **argv) {
+    for (int i = 0; i < UART_RX_PORT_COUNT; i++) {
+        const uartRxStats_t *stats = &uartRxPorts[i].stats;
+
+        if (uartRxPorts[i].huart == NULL) {
+            continue;
+        }
+        Shell_Print(shell, "usart%d rx: %lu bytes, %lu irq, ring max %u/%u\n\r",
+                uartRxPorts[i].huart->Instance == USART1 ? 1 : 2,
+                stats->bytes, stats->events, stats->maxLevel, UART_RX_RING_SIZE);
+        Shell_Print(shell, "overruns %lu, restarts %lu\n\r", stats->overruns, stats->restarts);
+    }
+    return 0;
+}
+
+SHELL_COMMAND("UART_STAT", uartRxCmdStat, 0, 0, "", "UART reception statistics");
@@ -0,0 +1,221 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    uart_tx.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include <string.h>
+#include "uart_tx.h"
+#include "shell.h"
+
+/**
+ * @brief Transmission ring of one port.
+ *
+ * head and tail are free-running byte counters: the writer only moves head,
+ * the DMA completion only moves tail, so the ring level is head - tail. The
+ * DMA always sends one contiguous chunk, from tail up to head or to the end
+ * of the ring.
+ */
+typedef struct uartTx_s {
+    UART_HandleTypeDef *huart;                              /**< NULL while the port is not started */
+    uint8_t ring[UART_TX_RING_SIZE];
+    volatile uint32_t head;                                 /**< Bytes queued since start, writer side */
+    volatile uint32_t tail;                                 /**< Bytes sent since start, interrupt side */
+    volatile uint16_t inFlight;                             /**< Length of the DMA transfer, 0 when idle */
+    uartTxStats_t stats;
+} uartTx_t;
+
+static uartTx_t uartTxPorts[UART_TX_PORT_COUNT];
+
+/**
+ * @brief Transmission ring of a UART.
+ *
+ * @return The ring, NULL if uartTxInit() was not called for this UART.
+ */
+static uartTx_t *uartTxGet(UART_HandleTypeDef *huart) {
+    for (int i = 0; i < UART_TX_PORT_COUNT; i++) {
+        if (uartTxPorts[i].huart == huart) {
+            return &uartTxPorts[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Start the next chunk if the DMA is idle.
+ *
+ * Runs with interrupts masked or from the UART interrupt.
+ */
+static void uartTxKick(uartTx_t *tx) {
+    uint32_t pos = tx->tail % UART_TX_RING_SIZE;
+    uint32_t len = tx->head - tx->tail;
+
+    if (tx->inFlight != 0 || len == 0) {
+        return;
+    }
+    if (len > UART_TX_RING_SIZE - pos) {
+        len = UART_TX_RING_SIZE - pos;                      /**< The wrapped part goes in the next transfer */
+    }
+    if (HAL_UART_Transmit_DMA(tx->huart, &tx->ring[pos], len) == HAL_OK) {
+        tx->inFlight = len;
+        tx->stats.transfers++;
+    }
+}
+
+/**
+ * @brief Start the DMA transmission of a UART.
+ *
+ * The UART must have a TX DMA stream linked (usart.c).
+ *
+ * @param huart UART to transmit on.
+ * @return 0 on success, 1 if no port is left or no DMA is linked.
+ */
+uint8_t uartTxInit(UART_HandleTypeDef *huart) {
+    uartTx_t *tx = uartTxGet(huart);
+
+    if (tx == NULL) {
+        tx = uartTxGet(NULL);
+        if (tx == NULL || huart->hdmatx == NULL) {
+            return 1;
+        }
+    }
+    tx->head = 0;
+    tx->tail = 0;
+    tx->inFlight = 0;
+    tx->stats = (uartTxStats_t){0};
+    tx->huart = huart;
+    return 0;
+}
+
+/**
+ * @brief Queue bytes for transmission and return at once.
+ *
+ * A write that does not fit in the free space is refused as a whole, so a
+ * slow port loses complete lines rather than their end. The refused bytes
+ * are counted in the statistics.
+ *
+ * @param huart UART to transmit on.
+ * @param data Bytes to send, copied.
+ * @param len Number of bytes.
+ * @return 0 if queued, 1 if refused (ring full or port not started).
+ */
+uint8_t uartTxWrite(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t len) {
+    uartTx_t *tx = uartTxGet(huart);
+    uint32_t head, pos, chunk, level;
+
+    if (tx == NULL) {
+        return 1;
+    }
+    head = tx->head;
+    level = head - tx->tail;                                /**< tail only grows, the free space can only be larger */
+    if (len > UART_TX_RING_SIZE - level) {
+        tx->stats.dropped += len;
+        return 1;
+    }
+
+    pos = head % UART_TX_RING_SIZE;
+    chunk = UART_TX_RING_SIZE - pos;
+    if (chunk > len) {
+        chunk = len;
+    }
+    memcpy(&tx->ring[pos], data, chunk);
+    memcpy(tx->ring, &data[chunk], len - chunk);
+
+    __disable_irq();
+    tx->head = head + len;
+    uartTxKick(tx);
+    __enable_irq();
+
+    tx->stats.bytes += len;
+    if (level + len > tx->stats.maxLevel) {
+        tx->stats.maxLevel = level + len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Bytes waiting or in flight on a UART.
+ *
+ * @return The ring level, 0 if the port is not started.
+ */
+uint16_t uartTxLevel(UART_HandleTypeDef *huart) {
+    uartTx_t *tx = uartTxGet(huart);
+
+    return tx != NULL ? tx->head - tx->tail : 0;
+}
+
+/**
+ * @brief Transmission statistics of a UART.
+ *
+ * @return The statistics, NULL if uartTxInit() was not called for this UART.
+ */
+const uartTxStats_t* uartTxGetStats(UART_HandleTypeDef *huart) {
+    uartTx_t *tx = uartTxGet(huart);
+
+    return tx != NULL ? &tx->stats : NULL;
+}
+
+/**
+ * @brief Transmission complete: release the chunk and start the next one.
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+    uartTx_t *tx = uartTxGet(huart);
+
+    if (tx == NULL) {
+        return;
+    }
+    tx->tail += tx->inFlight;
+    tx->stats.sent += tx->inFlight;
+    tx->inFlight = 0;
+    uartTxKick(tx);
+}
+
+/**
+ * @brief UART error: a DMA transmission aborted by the HAL is dropped.
+ *
+ * Reception errors are masked by uart_rx.c, only the transmit side can end
+ * up here with the transmitter back to ready.
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+    uartTx_t *tx = uartTxGet(huart);
+
+    if (tx == NULL || tx->inFlight == 0 || huart->gState != HAL_UART_STATE_READY) {
+        return;
+    }
+    tx->tail += tx->inFlight;
+    tx->stats.errors++;
+    tx->inFlight = 0;
+    uartTxKick(tx);
+}
+
+/* Shell commands ------------------------------------------------------------*/
+
+/**
+ * @brief UART_TX: transmission statistics of every started port.
+ */
+static uint8_t uartTxCmdStat(shell_t *shell, int argc, char **argv) {
+    for (int i = 0; i < UART_TX_PORT_COUNT; i++) {
+        const uartTxStats_t *stats = &uartTxPorts[i].stats;
+
+        if (uartTxPorts[i].huart == NULL) {
+            continue;
+        }
+        Shell_Print(shell, "usart%d tx: %lu bytes, %lu sent, %lu dma, ring max %u/%u\r\n",
+                uartTxPorts[i].huart->Instance == USART1 ? 1 : 2,
+                stats->bytes, stats->sent, stats->transfers, stats->maxLevel, UART_TX_RING_SIZE);
+        Shell_Print(shell, "dropped %lu, errors %lu\r\n", stats->dropped, stats->errors);
+    }
+    return 0;
+}
+
+SHELL_COMMAND("UART_TX", uartTxCmdStat, 0, 0, "", "UART transmission statistics");
@@ -0,0 +1,390 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    vibration.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief
+ *
+ **/
+
+#include "main.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "can.h"
+#include "shell.h"
+#include "timing.h"
+#include "vibration.h"
+
+#define VIBRATION_PI	3.14159265f
+
+static float vibrationCapture[VIBRATION_MAX_SIZE];      /**< Filled from the IMU samples */
+static float vibrationWork[VIBRATION_MAX_SIZE];         /**< N/2 complex points, re/im interleaved */
+static float vibrationTwiddle[VIBRATION_MAX_SIZE];      /**< cos/sin of -2 pi k / N, k < N/2 */
+static float vibrationWindowTable[VIBRATION_MAX_SIZE];
+static float vibrationPower[VIBRATION_MAX_SIZE / 2 + 1]; /**< |X[k]|^2, k = 0..N/2 */
+
+static uint16_t vibrationSize;
+static uint8_t vibrationPeaks;
+static float vibrationWindowGain;       /**< mean(w), amplitude correction */
+static float vibrationWindowPower;      /**< mean(w^2), energy correction */
+static volatile uint16_t vibrationCount; /**< Captured points, == vibrationSize when ready */
+static uint32_t vibrationPeriodUs;
+static vibrationReport_t vibrationReport;
+
+/**
+ * @brief Choose block size, window, axis and number of peaks, restart the capture.
+ *
+ * Twiddles and window are tabulated here so that a block only costs
+ * multiply-adds. Called from the main loop only.
+ *
+ * @param size Points per block, power of 2 from VIBRATION_MIN_SIZE to VIBRATION_MAX_SIZE.
+ * @param window Window applied before the FFT.
+ * @param axis Accelerometer axis 0..2, or VIBRATION_AXIS_NORM.
+ * @param peaks Number of peaks reported, 1 to VIBRATION_MAX_PEAKS.
+ * @return 0 if successful, 1 if a parameter is invalid.
+ */
+uint8_t vibrationConfigure(uint16_t size, vibrationWindow_t window, uint8_t axis, uint8_t peaks) {
+    float sum = 0.0f, sumSquares = 0.0f;
+
+    if (size < VIBRATION_MIN_SIZE || size > VIBRATION_MAX_SIZE || (size & (size - 1)) != 0
+            || window >= VIBRATION_WINDOW_COUNT || axis > VIBRATION_AXIS_NORM
+            || peaks == 0 || peaks > VIBRATION_MAX_PEAKS) {
+        return 1;
+    }
+
+    vibrationSize = 0; /**< Stops vibrationSample() while the tables change */
+
+    for (uint16_t k = 0; k < size / 2; k++) {
+        vibrationTwiddle[2 * k] = cosf(2.0f * VIBRATION_PI * k / size);
+        vibrationTwiddle[2 * k + 1] = -sinf(2.0f * VIBRATION_PI * k / size);
+    }
+
+    for (uint16_t n = 0; n < size; n++) {
+        float phase = 2.0f * VIBRATION_PI * n / size; /**< Periodic windows, for spectral analysis */
+        float w;
+
+        switch (window) {
+        case VIBRATION_WINDOW_HANN:
+            w = 0.5f - 0.5f * cosf(phase);
+            break;
+        case VIBRATION_WINDOW_HAMMING:
+            w = 0.54f - 0.46f * cosf(phase);
+            break;
+        case VIBRATION_WINDOW_BLACKMAN:
+            w = 0.42f - 0.5f * cosf(phase) + 0.08f * cosf(2.0f * phase);
+            break;
+        default:
+            w = 1.0f;
+            break;
+        }
+        vibrationWindowTable[n] = w;
+        sum += w;
+        sumSquares += w * w;
+    }
+    vibrationWindowGain = sum / size;
+    vibrationWindowPower = sumSquares / size;
+
+    memset(&vibrationReport, 0, sizeof(vibrationReport));
+    vibrationReport.size = size;
+    vibrationReport.window = window;
+    vibrationReport.axis = axis;
+    vibrationPeaks = peaks;
+    vibrationCount = 0;
+    vibrationSize = size;
+
+    return 0;
+}
+
+/**
+ * @brief Add one accelerometer sample to the block being captured.
+ *
+ * Called for every IMU sample, from the interrupt path. Samples are ignored
+ * while a full block waits for vibrationProcess().
+ *
+ * @param accel Acceleration in g.
+ * @param periodUs Sample period of the IMU.
+ * @return None
+ */
+void vibrationSample(const float accel[3], uint32_t periodUs) {
+    uint16_t count = vibrationCount;
+
+    if (vibrationSize == 0 || count >= vibrationSize) {
+        return;
+    }
+
+    if (vibrationReport.axis == VIBRATION_AXIS_NORM) {
+        vibrationCapture[count] = sqrtf(accel[0] * accel[0] + accel[1] * accel[1] + accel[2] * accel[2]);
+    }
+    else {
+        vibrationCapture[count] = accel[vibrationReport.axis];
+    }
+    vibrationPeriodUs = periodUs;
+    vibrationCount = count + 1;
+}
+
+/**
+ * @brief In-place radix-2 complex FFT of vibrationWork.
+ *
+ * @param n Number of complex points (N/2), power of 2.
+ * @param stride Twiddle step: the table holds N/2 entries for N real points.
+ */
+static void vibrationFftComplex(uint16_t n, uint16_t stride) {
+    float *x = vibrationWork;
+
+    for (uint16_t i = 1, j = 0; i < n; i++) { /**< Bit-reversal permutation */
+        uint16_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float re = x[2 * i], im = x[2 * i + 1];
+            x[2 * i] = x[2 * j];
+            x[2 * i + 1] = x[2 * j + 1];
+            x[2 * j] = re;
+            x[2 * j + 1] = im;
+        }
+    }
+
+    for (uint16_t len = 2; len <= n; len <<= 1) {
+        uint16_t half = len >> 1;
+        uint16_t step = stride * (n / len);
+
+        for (uint16_t start = 0; start < n; start += len) {
+            for (uint16_t k = 0; k < half; k++) {
+                float wr = vibrationTwiddle[2 * k * step];
+                float wi = vibrationTwiddle[2 * k * step + 1];
+                float *a = &x[2 * (start + k)];
+                float *b = &x[2 * (start + k + half)];
+                float tr = b[0] * wr - b[1] * wi;
+                float ti = b[0] * wi + b[1] * wr;
+
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Power spectrum of N real points in vibrationWork.
+ *
+ * Same scheme as arm_rfft_fast_f32: the real block is packed as N/2 complex
+ * points, transformed, then split into the N/2 + 1 bins of the real
+ * spectrum with one more twiddle pass.
+ *
+ * @param size N.
+ */
+static void vibrationRealFft(uint16_t size) {
+    uint16_t half = size / 2;
+    float *z = vibrationWork;
+
+    vibrationFftComplex(half, 2);
+
+    vibrationPower[0] = (z[0] + z[1]) * (z[0] + z[1]);          /**< DC */
+    vibrationPower[half] = (z[0] - z[1]) * (z[0] - z[1]);       /**< Nyquist */
+    for (uint16_t k = 1; k < half; k++) {
+        float ar = z[2 * k], ai = z[2 * k + 1];                 /**< Z[k] */
+        float br = z[2 * (half - k)], bi = -z[2 * (half - k) + 1]; /**< conj(Z[N/2 - k]) */
+        float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);     /**< Even samples */
+        float dr = 0.5f * (ai - bi), di = -0.5f * (ar - br);    /**< Odd samples: -j/2 (Z[k] - conj) */
+        float wr = vibrationTwiddle[2 * k], wi = vibrationTwiddle[2 * k + 1];
+        float xr = er + dr * wr - di * wi;
+        float xi = ei + dr * wi + di * wr;
+
+        vibrationPower[k] = xr * xr + xi * xi;
+    }
+}
+
+/**
+ * @brief Keep the highest local maxima of the spectrum, highest first.
+ */
+static void vibrationFindPeaks(uint16_t size, float binHz) {
+    vibrationReport_t *report = &vibrationReport;
+    float scale = 2.0f / (size * vibrationWindowGain);
+
+    report->peakCount = 0;
+    for (uint16_t k = 1; k < size / 2; k++) {
+        float p = vibrationPower[k];
+        float amplitude, l, c, r, den;
+        int slot;
+
+        if (p <= vibrationPower[k - 1] || p < vibrationPower[k + 1]) {
+            continue;
+        }
+        amplitude = sqrtf(p) * scale;
+        if (report->peakCount < vibrationPeaks) {
+            slot = report->peakCount++;
+        }
+        else if (amplitude > report->peaks[vibrationPeaks - 1].amplitude) {
+            slot = vibrationPeaks - 1; /**< Replaces the smallest */
+        }
+        else {
+            continue;
+        }
+        for (; slot > 0 && report->peaks[slot - 1].amplitude < amplitude; slot--) {
+            report->peaks[slot] = report->peaks[slot - 1];
+        }
+
+        /* Parabolic interpolation on the log power of the 3 bins */
+        l = logf(vibrationPower[k - 1] + 1e-20f);
+        c = logf(p + 1e-20f);
+        r = logf(vibrationPower[k + 1] + 1e-20f);
+        den = l - 2.0f * c + r;
+        report->peaks[slot].freqHz = (k + (den != 0.0f ? 0.5f * (l - r) / den : 0.0f)) * binHz;
+        report->peaks[slot].amplitude = amplitude;
+    }
+}
+
+/**
+ * @brief Send the band RMS and the peaks on CAN.
+ *
+ * Frames that find no free mailbox are dropped and counted, the next block
+ * sends fresh values anyway.
+ */
+static void vibrationCanSend(void) {
+    vibrationReport_t *report = &vibrationReport;
+    CAN_TxHeaderTypeDef header = {0};
+    uint8_t data[8];
+    uint32_t mailbox;
+
+    header.IDE = CAN_ID_STD;
+    header.RTR = CAN_RTR_DATA;
+    header.DLC = 8;
+
+    header.StdId = VIBRATION_CAN_ID_BANDS;
+    for (int i = 0; i < VIBRATION_BANDS; i++) {
+        uint16_t mg = report->bandRms[i] * 1000.0f > 65535.0f ? 65535 : (uint16_t)(report->bandRms[i] * 1000.0f);
+        data[2 * i] = mg >> 8;
+        data[2 * i + 1] = mg & 0xFF;
+    }
+    if (HAL_CAN_GetTxMailboxesFreeLevel(&hcan1) == 0 || HAL_CAN_AddTxMessage(&hcan1, &header, data, &mailbox) != HAL_OK) {
+        report->canDropped++;
+    }
+
+    for (int i = 0; i < report->peakCount; i += 2) {
+        memset(data, 0, sizeof(data));
+        for (int j = 0; j < 2 && i + j < report->peakCount; j++) {
+            float dHz = report->peaks[i + j].freqHz * 10.0f;
+            float mg = report->peaks[i + j].amplitude * 1000.0f;
+            uint16_t f = dHz > 65535.0f ? 65535 : (uint16_t)dHz;
+            uint16_t a = mg > 65535.0f ? 65535 : (uint16_t)mg;
+            data[4 * j] = f >> 8;
+            data[4 * j + 1] = f & 0xFF;
+            data[4 * j + 2] = a >> 8;
+            data[4 * j + 3] = a & 0xFF;
+        }
+        header.StdId = VIBRATION_CAN_ID_PEAKS + i / 2;
+        if (HAL_CAN_GetTxMailboxesFreeLevel(&hcan1) == 0 || HAL_CAN_AddTxMessage(&hcan1, &header, data, &mailbox) != HAL_OK) {
+            report->canDropped++;
+        }
+    }
+}
+
+/**
+ * @brief Analyze the captured block once it is full, call it from the main loop.
+ *
+ * Removes the mean, applies the window, runs the real FFT, then extracts the
+ * peaks and the band RMS (Parseval, corrected for the window power) and
+ * sends them on CAN. The next block is captured afterwards: blocks do not
+ * overlap.
+ *
+ * @return 1 if a new report is available, 0 otherwise.
+ */
+uint8_t vibrationProcess(void) {
+    vibrationReport_t *report = &vibrationReport;
+    uint16_t size = vibrationSize;
+    uint32_t start;
+    float mean = 0.0f, binHz, energy;
+
+    if (size == 0 || vibrationCount < size) {
+        return 0;
+    }
+
+    start = timingCycles();
+
+    for (uint16_t n = 0; n < size; n++) {
+        mean += vibrationCapture[n];
+    }
+    mean /= size;
+    for (uint16_t n = 0; n < size; n++) {
+        vibrationWork[n] = (vibrationCapture[n] - mean) * vibrationWindowTable[n];
+    }
+    vibrationCount = 0; /**< Capture buffer free again */
+
+    vibrationRealFft(size);
+
+    report->sampleRateHz = 1000000.0f / vibrationPeriodUs;
+    binHz = report->sampleRateHz / size;
+    vibrationFindPeaks(size, binHz);
+
+    /* Parseval: one-sided bins count twice, DC and Nyquist once */
+    energy = 0.0f;
+    for (int b = 0; b < VIBRATION_BANDS; b++) {
+        uint16_t first = b * (size / 2) / VIBRATION_BANDS;
+        uint16_t last = (b + 1) * (size / 2) / VIBRATION_BANDS;
+        float sum = 0.0f;
+
+        for (uint16_t k = first == 0 ? 1 : first; k < last; k++) {
+            sum += 2.0f * vibrationPower[k];
+        }
+        if (b == VIBRATION_BANDS - 1) {
+            sum += vibrationPower[size / 2];
+        }
+        energy += sum;
+        report->bandRms[b] = sqrtf(sum / ((float)size * size * vibrationWindowPower));
+    }
+    report->rms = sqrtf(energy / ((float)size * size * vibrationWindowPower));
+    report->blocks++;
+    report->cycles = timingCycles() - start;
+
+    vibrationCanSend();
+
+    return 1;
+}
+
+/**
+ * @brief Last report, valid until the next vibrationProcess() that returns 1.
+ *
+ * @return Pointer to the report.
+ */
+const vibrationReport_t *vibrationGetReport(void) {
+    return &vibrationReport;
+}
+
+/* Shell commands ------------------------------------------------------------*/
+
+/**
+ * @brief VIB [n [window [axis [peaks]]]]: reconfigure the analysis, or show the last report.
+ *
+ * window 0-3 (rect, Hann, Hamming, Blackman), axis 0-2 or 3 = |a|. Omitted
+ * arguments keep their current value.
+ */
+static uint8_t vibrationCmd(shell_t *shell, int argc, char **argv) {
+    const vibrationReport_t *report = vibrationGetReport();
+
+    if (argc > 1 && vibrationConfigure(atoi(argv[1]), argc > 2 ? (vibrationWindow_t)atoi(argv[2]) : report->window,
+            argc > 3 ? atoi(argv[3]) : report->axis, argc > 4 ? atoi(argv[4]) : vibrationPeaks) != 0) {
+        return 1;
+    }
+    Shell_Print(shell, "n %u, window %d, axis %u, %.1f Hz, %lu blocks, %lu us/block, %lu CAN drops\n\r",
+            report->size, report->window, report->axis, report->sampleRateHz, report->blocks,
+            timingCyclesToUs(report->cycles), report->canDropped);
+    Shell_Print(shell, "rms %.4f g, bands %.4f %.4f %.4f %.4f g\n\r", report->rms,
+            report->bandRms[0], report->bandRms[1], report->bandRms[2], report->bandRms[3]);
+    for (int i = 0; i < report->peakCount; i++) {
+        Shell_Print(shell, "peak %d: %.2f Hz, %.4f g\n\r", i, report->peaks[i].freqHz, report->peaks[i].amplitude);
+    }
+    return 0;
+}
+
+SHELL_COMMAND("VIB", vibrationCmd, 0, 4, "[n [window [axis [peaks]]]]", "accelerometer vibration spectrum");
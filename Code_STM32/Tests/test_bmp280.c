@@ -0,0 +1,138 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    test_bmp280.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   Host check and benchmark of the BMP280 compensation paths
+ *
+ * The batch path must match bmp280CompensateTInt32() + bmp280CompensatePInt64()
+ * bit for bit on random raw words and calibrations. The samples/s figures are
+ * those of the host, BMP_BENCH gives the on-target ones.
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "BMP280/bmp280_compensation.h"
+
+#define CHECK_SAMPLES	1000000
+#define BENCH_SAMPLES	4096
+#define BENCH_ROUNDS	500
+
+static BMP280_S32_t adcT[BENCH_SAMPLES];
+static BMP280_S32_t adcP[BENCH_SAMPLES];
+static BMP280_S32_t temperature[BENCH_SAMPLES];
+static BMP280_U32_t pressure[BENCH_SAMPLES];
+
+static int failures;
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Raw word around the datasheet example, as a real sensor would give.
+ */
+static BMP280_S32_t randomAdc(BMP280_S32_t center) {
+    return center + rand() % 200001 - 100000;
+}
+
+/**
+ * @brief Reference calibration with every word moved by up to +-3 %.
+ */
+static void randomCalib(bmp280Calib_t *calib) {
+    int16_t *words = (int16_t *)calib;
+
+    *calib = bmp280RefCalib;
+    for (unsigned i = 1; i < sizeof(bmp280Calib_t) / sizeof(int16_t); i++) {
+        if (i != 3) { /**< dig_P1 is unsigned */
+            words[i] += words[i] / 33 * (rand() % 3 - 1);
+        }
+    }
+}
+
+/**
+ * @brief Datasheet vector on every path, then batch against single sample.
+ */
+static void testMatch(void) {
+    bmp280Calib_t calib;
+    uint32_t mismatches = 0;
+    uint8_t selfTest = bmp280SelfTest();
+
+    printf("selftest 0x%02X %s\n", selfTest, selfTest == 0 ? "ok" : "FAILED");
+    failures += selfTest != 0;
+
+    for (uint32_t i = 0; i < CHECK_SAMPLES; i += BENCH_SAMPLES) {
+        randomCalib(&calib);
+        for (int j = 0; j < BENCH_SAMPLES; j++) {
+            adcT[j] = randomAdc(BMP280_REF_ADC_T);
+            adcP[j] = randomAdc(BMP280_REF_ADC_P);
+        }
+        bmp280CompensateBatch(&calib, adcT, adcP, temperature, pressure, BENCH_SAMPLES);
+        for (int j = 0; j < BENCH_SAMPLES; j++) {
+            BMP280_S32_t tFine;
+            BMP280_S32_t t = bmp280CompensateTInt32(&calib, adcT[j], &tFine);
+
+            if (t != temperature[j] || bmp280CompensatePInt64(&calib, adcP[j], tFine) != pressure[j]) {
+                mismatches++;
+            }
+        }
+    }
+    printf("batch vs single: %lu mismatches %s\n", (unsigned long)mismatches, mismatches == 0 ? "ok" : "FAILED");
+    failures += mismatches != 0;
+}
+
+/**
+ * @brief Samples/s of the single sample 64-bit path and of the batch.
+ */
+static void benchmark(void) {
+    volatile BMP280_U32_t sink = 0;
+    double start, single, batch;
+
+    for (int j = 0; j < BENCH_SAMPLES; j++) {
+        adcT[j] = randomAdc(BMP280_REF_ADC_T);
+        adcP[j] = randomAdc(BMP280_REF_ADC_P);
+    }
+
+    start = now();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int j = 0; j < BENCH_SAMPLES; j++) {
+            BMP280_S32_t tFine;
+
+            temperature[j] = bmp280CompensateTInt32(&bmp280RefCalib, adcT[j], &tFine);
+            pressure[j] = bmp280CompensatePInt64(&bmp280RefCalib, adcP[j], tFine);
+        }
+        sink += pressure[r % BENCH_SAMPLES];
+    }
+    single = now() - start;
+
+    start = now();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        bmp280CompensateBatch(&bmp280RefCalib, adcT, adcP, temperature, pressure, BENCH_SAMPLES);
+        sink += pressure[r % BENCH_SAMPLES];
+    }
+    batch = now() - start;
+
+    printf("host single: %.1f Msamples/s\n", BENCH_ROUNDS * BENCH_SAMPLES / single / 1e6);
+    printf("host batch:  %.1f Msamples/s\n", BENCH_ROUNDS * BENCH_SAMPLES / batch / 1e6);
+    (void)sink;
+}
+
+int main(void) {
+    srand(1);
+    testMatch();
+    benchmark();
+
+    printf("%d failure(s)\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,165 @@
+/**
+ *     _______    _____     __     ______    _______        ____
+ *    |   ____|  |     \   |  |   / _____)  |   ____|      /    \
+ *    |  |__     |  |\  \  |  |  ( (____    |  |__        /  /\  \
+ *    |   __|    |  | \  \ |  |   \____ \   |   __|      /  ____  \
+ *    |  |____   |  |  \  \|  |   _____) )  |  |____    /  /    \  \
+ *    |_______|  |__|   \_____|  (______/   |_______|  /__/      \__\
+ *
+ * @file    test_fusion.c
+ * @Author  Dorian Dalbin, Gael Gourdin
+ * @Created	2026-10-17
+ * @brief   Host replay of synthetic IMU sequences through the Madgwick filter
+ *
+ * Each case feeds a sequence at the 500 Hz rate of the target and checks the
+ * resulting quaternion. Sensor readings are built from the true orientation:
+ * gravity (0, 0, 1) g and a field (FIELD_X, 0, FIELD_Z) uT in the earth
+ * frame, rotated into the sensor frame.
+ *
+ **/
+
+#include <math.h>
+#include <stdio.h>
+#include "fusion.h"
+
+#define SAMPLE_DT		0.002f		// 500 Hz, MPU9250_PROFILE_500HZ
+#define FIELD_X			20.0f		// uT, horizontal component
+#define FIELD_Z			-40.0f		// uT, vertical component
+
+static int failures;
+
+static void check(const char *name, float value, float expected, float tolerance) {
+    int ok = fabsf(value - expected) <= tolerance;
+
+    printf("%-28s %10.4f, expected %10.4f +- %.4f %s\n", name, value, expected, tolerance, ok ? "ok" : "FAILED");
+    if (!ok) {
+        failures++;
+    }
+}
+
+static float norm(const fusionQuaternion_t *q) {
+    return sqrtf(q->w * q->w + q->x * q->x + q->y * q->y + q->z * q->z);
+}
+
+/**
+ * @brief Gyroscope only (gain 0): 90 deg/s about z for 1 s ends at a 90 deg yaw.
+ */
+static void testGyroIntegration(void) {
+    const float gyro[3] = {0.0f, 0.0f, 90.0f};
+    const float accel[3] = {0.0f, 0.0f, 1.0f};
+    fusion_t fusion;
+    fusionEuler_t euler;
+
+    fusionInit(&fusion, 0.0f);
+    for (int i = 0; i < 500; i++) {
+        fusionUpdate(&fusion, gyro, accel, NULL, SAMPLE_DT);
+    }
+    fusionGetEuler(&fusion.q, &euler);
+    check("gyro: q.w", fusion.q.w, cosf(0.25f * (float)M_PI), 1e-3f);
+    check("gyro: q.z", fusion.q.z, sinf(0.25f * (float)M_PI), 1e-3f);
+    check("gyro: yaw", euler.yaw, 90.0f, 0.1f);
+    check("gyro: |q|", norm(&fusion.q), 1.0f, 1e-5f);
+    check("gyro: 6-axis updates", fusion.stats.updatesNoMag, 500, 0);
+}
+
+/**
+ * @brief At rest, tilted 30 deg in roll: gravity pulls the identity to the tilt.
+ */
+static void testGravityConvergence(void) {
+    const float gyro[3] = {0.0f, 0.0f, 0.0f};
+    const float accel[3] = {0.0f, sinf(30.0f * FUSION_DEG_TO_RAD), cosf(30.0f * FUSION_DEG_TO_RAD)};
+    fusion_t fusion;
+    fusionEuler_t euler;
+
+    fusionInit(&fusion, 0.5f);
+    for (int i = 0; i < 5000; i++) {
+        fusionUpdate(&fusion, gyro, accel, NULL, SAMPLE_DT);
+    }
+    fusionGetEuler(&fusion.q, &euler);
+    check("gravity: roll", euler.roll, 30.0f, 0.5f);
+    check("gravity: pitch", euler.pitch, 0.0f, 0.5f);
+    check("gravity: q.x", fusion.q.x, sinf(15.0f * FUSION_DEG_TO_RAD), 5e-3f);
+}
+
+/**
+ * @brief Level, heading 45 deg: the magnetometer pulls the yaw, not the tilt.
+ */
+static void testHeadingConvergence(void) {
+    const float yaw = 45.0f * FUSION_DEG_TO_RAD;
+    const float gyro[3] = {0.0f, 0.0f, 0.0f};
+    const float accel[3] = {0.0f, 0.0f, 1.0f};
+    const float mag[3] = {FIELD_X * cosf(yaw), -FIELD_X * sinf(yaw), FIELD_Z};
+    fusion_t fusion;
+    fusionEuler_t euler;
+
+    fusionInit(&fusion, 0.5f);
+    for (int i = 0; i < 10000; i++) {
+        fusionUpdate(&fusion, gyro, accel, mag, SAMPLE_DT);
+    }
+    fusionGetEuler(&fusion.q, &euler);
+    check("heading: yaw", euler.yaw, 45.0f, 0.5f);
+    check("heading: roll", euler.roll, 0.0f, 0.5f);
+    check("heading: pitch", euler.pitch, 0.0f, 0.5f);
+    check("heading: 6-axis updates", fusion.stats.updatesNoMag, 0, 0);
+}
+
+/**
+ * @brief No gyro (start-up after a wake-up): accel + mag alone still reach the tilt and heading.
+ */
+static void testWithoutGyro(void) {
+    const float roll = 20.0f * FUSION_DEG_TO_RAD;
+    const float accel[3] = {0.0f, sinf(roll), cosf(roll)};
+    const float mag[3] = {FIELD_X, FIELD_Z * sinf(roll), FIELD_Z * cosf(roll)};
+    fusion_t fusion;
+    fusionEuler_t euler;
+
+    fusionInit(&fusion, 0.5f);
+    for (int i = 0; i < 5000; i++) {
+        fusionUpdate(&fusion, NULL, accel, mag, SAMPLE_DT);
+    }
+    fusionGetEuler(&fusion.q, &euler);
+    check("no gyro: roll", euler.roll, 20.0f, 0.5f);
+    check("no gyro: yaw", euler.yaw, 0.0f, 0.5f);
+    check("no gyro: |q|", norm(&fusion.q), 1.0f, 1e-5f);
+    check("no gyro: updates", fusion.stats.updatesNoGyro, 5000, 0);
+}
+
+/**
+ * @brief Turning at 30 deg/s about z with a gyro bias: accel + mag keep the tilt and track the heading.
+ */
+static void testTrackingWithBias(void) {
+    const float bias[3] = {0.5f, -0.5f, 0.3f};           // deg/s, typical before IMU_CAL
+    const float rate = 30.0f;
+    const float accel[3] = {0.0f, 0.0f, 1.0f};
+    fusion_t fusion;
+    fusionEuler_t euler;
+    float yaw = 0.0f;
+
+    fusionInit(&fusion, FUSION_DEFAULT_GAIN);
+    for (int i = 0; i < 3000; i++) {
+        const float gyro[3] = {bias[0], bias[1], rate + bias[2]};
+        float mag[3];
+
+        yaw += rate * SAMPLE_DT * FUSION_DEG_TO_RAD;
+        mag[0] = FIELD_X * cosf(yaw);
+        mag[1] = -FIELD_X * sinf(yaw);
+        mag[2] = FIELD_Z;
+        fusionUpdate(&fusion, gyro, accel, mag, SAMPLE_DT);
+    }
+    fusionGetEuler(&fusion.q, &euler);
+    check("tracking: yaw error", remainderf(euler.yaw - yaw * FUSION_RAD_TO_DEG, 360.0f), 0.0f, 2.0f);
+    check("tracking: roll", euler.roll, 0.0f, 1.0f);
+    check("tracking: pitch", euler.pitch, 0.0f, 1.0f);
+    check("tracking: |q|", norm(&fusion.q), 1.0f, 1e-5f);
+}
+
+int main(void) {
+    testGyroIntegration();
+    testGravityConvergence();
+    testHeadingConvergence();
+    testTrackingWithBias();
+    testWithoutGyro();
+
+    printf("%d failure(s)\n", failures);
+    return failures != 0;
+}